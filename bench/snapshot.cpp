@@ -0,0 +1,39 @@
+// Time of a full ProcessCollector::update() for a range of thread counts
+// Usage: bench/snapshot [rounds] [max jobs]
+#include "../src/collector.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+static double ms_per_update(unsigned jobs, int rounds, size_t *pids) {
+	ProcessCollector collector(jobs);
+	// First pass opens the pid handles
+	collector.update();
+
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < rounds; r++)
+		collector.update();
+	auto end = std::chrono::steady_clock::now();
+
+	*pids = collector.latest()->processes.size();
+	return std::chrono::duration<double, std::milli>(end - start).count() / rounds;
+}
+
+int main(int argc, char *argv[]) {
+	int rounds = argc > 1 ? std::stoi(argv[1]) : 20;
+	unsigned max_jobs = argc > 2 ? std::stoi(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+
+	size_t pids = 0;
+	double serial_ms = ms_per_update(1, rounds, &pids);
+	std::cout << pids << " pids, " << rounds << " rounds" << std::endl;
+	std::cout << "jobs 1:\t" << serial_ms << " ms/update" << std::endl;
+	for (unsigned jobs = 2; jobs <= max_jobs; jobs *= 2) {
+		double ms = ms_per_update(jobs, rounds, &pids);
+		std::cout << "jobs " << jobs << ":\t" << ms << " ms/update, "
+			<< serial_ms / ms << "x" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,100 @@
+// Cost of ordering a process table by a rate: a by-value comparator over the
+// rows against ProcessTable::sort_top() on the whole table and on a window
+// Usage: bench/sort [rows] [window] [rounds]
+#include "../src/process_table.hpp"
+
+#include <chrono>
+#include <cstdio> // snprintf
+#include <iostream>
+#include <random>
+#include <string>
+
+// Normally defined in util.cpp, which pulls in the rest of the UI
+bool lock = false;
+
+// About as fat as the rows of the tabs
+struct bench_row {
+	struct process		process = {};
+	struct pid_stat		stats = {};
+	double				usage_percent = 0;
+};
+
+struct bench_source {
+	struct process	process = {};
+	double			usage_percent = 0;
+};
+
+struct bench_sampler {
+	typedef struct bench_source source;
+
+	struct pid_key key(const source &src) const {
+		return {src.process.pid, src.process.starttime};
+	}
+	void init(struct bench_row *row, const source &src) {
+		row->process = src.process;
+	}
+	void sample(struct bench_row *row, const source &src) {
+		row->usage_percent = src.usage_percent;
+	}
+};
+
+// The comparator sort_vector() used to take, rows passed by value
+static bool by_usage(struct bench_row a, struct bench_row b) {
+	return a.usage_percent > b.usage_percent;
+}
+
+template<typename Fn>
+static double us_per_sort(int rounds, Fn fn) {
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < rounds; r++)
+		fn();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(end - start).count() / rounds;
+}
+
+int main(int argc, char *argv[]) {
+	size_t rows = argc > 1 ? std::stoul(argv[1]) : 10000;
+	size_t window = argc > 2 ? std::stoul(argv[2]) : 100;
+	int rounds = argc > 3 ? std::stoi(argv[3]) : 20;
+
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<double> usage(0, 100);
+	std::vector<struct bench_source> sources(rows);
+	std::vector<struct bench_row> fat(rows);
+	for (size_t i = 0; i < rows; i++) {
+		sources[i].process.pid = i + 1;
+		snprintf(sources[i].process.name, sizeof(sources[i].process.name), "process-name-%zu", i);
+		sources[i].usage_percent = usage(rng);
+		fat[i].process = sources[i].process;
+		fat[i].usage_percent = sources[i].usage_percent;
+	}
+
+	ProcessTable<struct bench_row, struct bench_sampler> table;
+	table.update(sources);
+	auto key = [](const struct bench_row &row) {
+		return row.usage_percent;
+	};
+
+	std::vector<struct bench_row> copy;
+	double by_value_us = us_per_sort(rounds, [&] {
+		copy = fat;
+		std::sort(copy.begin(), copy.end(), by_usage);
+	});
+	double copy_us = us_per_sort(rounds, [&] {
+		copy = fat;
+	});
+	double full_us = us_per_sort(rounds, [&] {
+		table.sort_top(rows, key);
+	});
+	double top_us = us_per_sort(rounds, [&] {
+		table.sort_top(window, key);
+	});
+
+	std::cout << rows << " rows, window " << window << ", " << rounds << " rounds" << std::endl;
+	std::cout << "by value std::sort:\t" << by_value_us - copy_us << " us/sort" << std::endl;
+	std::cout << "sort_top(all):\t\t" << full_us << " us/sort" << std::endl;
+	std::cout << "sort_top(window):\t" << top_us << " us/sort, "
+		<< (by_value_us - copy_us) / top_us << "x" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,91 @@
+// Microbenchmark of read_pid_stat against the previous ifstream version
+#include "../src/proc.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// read_pid_stat as it was before the single read() parser
+static void read_pid_stat_ifstream(int32_t pid, struct pid_stat *stats) {
+	std::string filepath(std::string("/proc/") + std::to_string(pid) + "/stat");
+    std::ifstream infile(filepath);
+    if (!infile.is_open())
+		return;
+
+	std::string comm;
+	infile >> stats->pid >> comm >> stats->state >> stats->ppid
+		>> stats->pgrp >> stats->session >> stats->tty_nr >> stats->tpgid
+		>> stats->flags >> stats->minflt >> stats->cminflt >> stats->majflt
+		>> stats->cmajflt >> stats->utime >> stats->stime >> stats->cutime
+		>> stats->cstime >> stats->priority >> stats->nice >> stats->num_threads
+		>> stats->itrealvalue >> stats->starttime >> stats->vsize >> stats->rss
+		>> stats->rsslim >> stats->startcode >> stats->endcode >> stats->startstack
+		>> stats->kstkesp >> stats->kstkeip >> stats->signal >> stats->blocked
+		>> stats->sigignore >> stats->sigcatch >> stats->wchan >> stats->nswap
+		>> stats->cnswap >> stats->exit_signal >> stats->processor
+		>> stats->rt_priority >> stats->policy >> stats->delayacct_blkio_ticks
+		>> stats->guest_time >> stats->cguest_time;
+}
+
+// Path based, like the ifstream reader
+static void read_pid_stat_path(int32_t pid, struct pid_stat *stats) {
+	struct pid_handle handle;
+	handle.pid = pid;
+	read_pid_stat(&handle, stats);
+}
+
+template<typename Reader>
+static double ns_per_call(const std::vector<int32_t> &pids, int rounds, Reader reader) {
+	struct pid_stat stats;
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < rounds; r++)
+		for (int32_t pid : pids)
+			reader(pid, &stats);
+	auto end = std::chrono::steady_clock::now();
+	double ns = std::chrono::duration<double, std::nano>(end - start).count();
+	return ns / (rounds * pids.size());
+}
+
+int main(int argc, char *argv[]) {
+	int rounds = argc > 1 ? std::stoi(argv[1]) : 50;
+
+	std::vector<int32_t> pids;
+	find_processes(&pids);
+	if (pids.empty()) {
+		std::cout << "No processes found" << std::endl;
+		return 1;
+	}
+
+	// Both should agree on everything after comm
+	int mismatches = 0;
+	for (int32_t pid : pids) {
+		struct pid_stat a = {};
+		struct pid_stat b = {};
+		read_pid_stat_ifstream(pid, &a);
+		read_pid_stat_path(pid, &b);
+		if (a.utime != b.utime || a.starttime != b.starttime || a.rss != b.rss)
+			mismatches++;
+	}
+
+	// Directory fds opened up front, like the snapshot keeps them
+	PidHandleCache handles;
+	for (int32_t pid : pids)
+		handles.get(pid);
+	auto read_pid_stat_at = [&handles](int32_t pid, struct pid_stat *stats) {
+		read_pid_stat(handles.get(pid), stats);
+	};
+
+	double old_ns = ns_per_call(pids, rounds, read_pid_stat_ifstream);
+	double new_ns = ns_per_call(pids, rounds, read_pid_stat_path);
+	double at_ns = ns_per_call(pids, rounds, read_pid_stat_at);
+
+	std::cout << pids.size() << " pids, " << rounds << " rounds" << std::endl;
+	std::cout << "ifstream:   " << old_ns << " ns/pid" << std::endl;
+	std::cout << "read():     " << new_ns << " ns/pid" << std::endl;
+	std::cout << "openat():   " << at_ns << " ns/pid" << std::endl;
+	std::cout << "speedup:    " << old_ns / new_ns << "x, " << old_ns / at_ns << "x with openat()" << std::endl;
+	std::cout << "mismatches: " << mismatches << " (comm with spaces or a pid that exited)" << std::endl;
+
+	return 0;
+}
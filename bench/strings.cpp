@@ -0,0 +1,60 @@
+// Memory of the command lines of the running processes, as one std::string
+// each against a StringArena, with every process repeated like the workers
+// of a pool, and the cost of an intern()/sweep() tick over them
+// Usage: bench/strings [copies] [rounds]
+#include "../src/proc.hpp"
+#include "../src/string_arena.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// Normally defined in util.cpp, which pulls in the rest of the UI
+bool lock = false;
+
+// Heap bytes behind s, short strings live inside the object
+static size_t heap_bytes(const std::string &s) {
+	return s.capacity() > std::string().capacity() ? s.capacity() + 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+	size_t copies = argc > 1 ? std::stoul(argv[1]) : 20;
+	int rounds = argc > 2 ? std::stoi(argv[2]) : 100;
+
+	std::vector<int32_t> pids;
+	find_processes(&pids);
+	std::vector<std::string> cmds;
+	for (int32_t pid : pids) {
+		struct pid_handle handle;
+		handle.pid = pid;
+		std::string cmd;
+		get_calling_command(&handle, &cmd, 4096);
+		for (size_t c = 0; c < copies; c++)
+			cmds.push_back(cmd);
+	}
+
+	size_t string_bytes = cmds.size() * sizeof(std::string);
+	for (const std::string &cmd : cmds)
+		string_bytes += heap_bytes(cmd);
+
+	StringArena arena;
+	std::vector<uint32_t> handles(cmds.size());
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < rounds; r++) {
+		for (size_t i = 0; i < cmds.size(); i++)
+			handles[i] = arena.intern(cmds[i]);
+		arena.sweep();
+	}
+	auto end = std::chrono::steady_clock::now();
+	size_t arena_bytes = handles.size() * sizeof(uint32_t) + arena.capacity();
+
+	std::cout << pids.size() << " processes, " << copies << " copies each, "
+		<< arena.size() << " distinct command lines" << std::endl;
+	std::cout << "std::string:\t" << string_bytes << " bytes" << std::endl;
+	std::cout << "StringArena:\t" << arena_bytes << " bytes (buffer and handles), "
+		<< (double)string_bytes / arena_bytes << "x smaller" << std::endl;
+	std::cout << "intern+sweep:\t" << std::chrono::duration<double, std::micro>(end - start).count() / rounds
+		<< " us/tick" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,70 @@
+// Cost per pid of the io counters through taskstats against /proc/{pid}/io
+#include "../src/proc.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+template<typename Reader>
+static double ns_per_call(const std::vector<int32_t> &pids, int rounds, Reader reader) {
+	struct pid_io io;
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < rounds; r++)
+		for (int32_t pid : pids)
+			reader(pid, &io);
+	auto end = std::chrono::steady_clock::now();
+	double ns = std::chrono::duration<double, std::nano>(end - start).count();
+	return ns / (rounds * pids.size());
+}
+
+int main(int argc, char *argv[]) {
+	int rounds = argc > 1 ? std::stoi(argv[1]) : 50;
+
+	TaskstatsSource taskstats;
+	if (!taskstats.open()) {
+		std::cout << "TASKSTATS genetlink family not available" << std::endl;
+		return 1;
+	}
+
+	std::vector<int32_t> all_pids;
+	find_processes(&all_pids);
+
+	// Only single threaded processes are read through taskstats
+	PidHandleCache handles;
+	std::vector<int32_t> pids;
+	for (int32_t pid : all_pids) {
+		struct pid_stat stat;
+		if (read_pid_stat(handles.get(pid), &stat) && stat.num_threads == 1)
+			pids.push_back(pid);
+	}
+	if (pids.empty()) {
+		std::cout << "No single threaded processes found" << std::endl;
+		return 1;
+	}
+
+	int mismatches = 0;
+	for (int32_t pid : pids) {
+		struct pid_io a = {};
+		struct pid_io b = {};
+		read_pid_io(handles.get(pid), &a);
+		taskstats.read_io(pid, &b);
+		if (a.rchar != b.rchar || a.read_bytes != b.read_bytes || a.write_bytes != b.write_bytes)
+			mismatches++;
+	}
+
+	double procfs_ns = ns_per_call(pids, rounds, [&handles](int32_t pid, struct pid_io *io) {
+		read_pid_io(handles.get(pid), io);
+	});
+	double taskstats_ns = ns_per_call(pids, rounds, [&taskstats](int32_t pid, struct pid_io *io) {
+		taskstats.read_io(pid, io);
+	});
+
+	std::cout << pids.size() << " of " << all_pids.size() << " pids single threaded, "
+		<< rounds << " rounds" << std::endl;
+	std::cout << "/proc/{pid}/io: " << procfs_ns << " ns/pid" << std::endl;
+	std::cout << "taskstats:      " << taskstats_ns << " ns/pid" << std::endl;
+	std::cout << "speedup:        " << procfs_ns / taskstats_ns << "x" << std::endl;
+	std::cout << "mismatches:     " << mismatches << " (procfs adds reaped children, counters moved or a pid exited)" << std::endl;
+
+	return 0;
+}
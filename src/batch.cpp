@@ -0,0 +1,110 @@
+#include "batch.hpp"
+
+#include <cinttypes> // PRIu64
+
+// A jsonl value that can go in without quotes
+static bool is_number(std::string_view value) {
+	if (value.empty())
+		return false;
+	size_t i = value[0] == '-' ? 1 : 0;
+	if (i == value.size() || value[i] < '0' || value[i] > '9')
+		return false;
+	// JSON has no leading zeros, "007" stays a string
+	if (value[i] == '0' && i + 1 < value.size() && value[i + 1] >= '0' && value[i + 1] <= '9')
+		return false;
+	bool dot = false;
+	for (; i < value.size(); i++) {
+		if (value[i] == '.' && !dot && i + 1 < value.size())
+			dot = true;
+		else if (value[i] < '0' || value[i] > '9')
+			return false;
+	}
+	return true;
+}
+
+void BatchWriter::begin_snapshot(const uint64_t time_ms) {
+	this->time_ms = time_ms;
+}
+
+void BatchWriter::end_snapshot() {
+	// Lines are read as they come, a pipe would hold them back otherwise
+	fflush(out);
+}
+
+void BatchWriter::begin_table(std::string_view table, const std::vector<std::string_view> &ids) {
+	this->table.assign(table);
+	this->ids = ids;
+	if (format != FORMAT_CSV || !headers.insert(this->table).second)
+		return;
+
+	fputs("time,table", out);
+	for (std::string_view id : ids) {
+		fputc(',', out);
+		write_quoted(id);
+	}
+	fputc('\n', out);
+}
+
+void BatchWriter::begin_row() {
+	fields = 0;
+	if (format == FORMAT_CSV) {
+		fprintf(out, "%" PRIu64 ",", time_ms);
+		write_quoted(table);
+	} else {
+		fprintf(out, "{\"time\":%" PRIu64 ",\"table\":", time_ms);
+		write_quoted(table);
+	}
+}
+
+void BatchWriter::field(std::string_view value) {
+	if (format == FORMAT_CSV) {
+		fputc(',', out);
+		write_quoted(value);
+	} else {
+		fputc(',', out);
+		write_quoted(fields < ids.size() ? ids[fields] : std::string_view());
+		fputc(':', out);
+		if (is_number(value))
+			fwrite(value.data(), 1, value.size(), out);
+		else
+			write_quoted(value);
+	}
+	fields++;
+}
+
+void BatchWriter::end_row() {
+	if (format == FORMAT_JSONL)
+		fputc('}', out);
+	fputc('\n', out);
+}
+
+void BatchWriter::write_quoted(std::string_view value) {
+	if (format == FORMAT_CSV) {
+		// Quoted only when it has to be, doubling the quotes inside
+		if (value.find_first_of(",\"\n\r") == std::string_view::npos) {
+			fwrite(value.data(), 1, value.size(), out);
+			return;
+		}
+		fputc('"', out);
+		for (char c : value) {
+			if (c == '"')
+				fputc('"', out);
+			fputc(c, out);
+		}
+		fputc('"', out);
+		return;
+	}
+
+	fputc('"', out);
+	for (unsigned char c : value) {
+		if (c == '"' || c == '\\') {
+			fputc('\\', out);
+			fputc(c, out);
+		} else if (c < 0x20) {
+			fprintf(out, "\\u%04x", c);
+		} else {
+			fputc(c, out);
+		}
+	}
+	fputc('"', out);
+}
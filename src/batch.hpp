@@ -0,0 +1,51 @@
+#ifndef BATCH_HPP_
+#define BATCH_HPP_
+
+#include "util.hpp" // enum batch_format
+
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+/* Streams process tables as text, one line per row, for --batch.
+ * Every row starts with the wall clock time of its snapshot and the table
+ * it's from, followed by the table's columns by id.
+ * csv writes a header line the first time a table shows up, jsonl writes
+ * one object per row. Values that are plain numbers aren't quoted in jsonl.
+ */
+class BatchWriter {
+public:
+	BatchWriter(const enum batch_format format, FILE *out = stdout) : format(format), out(out) {};
+	~BatchWriter() {};
+
+	// Rows from here on are stamped with time_ms, in ms since the epoch
+	void begin_snapshot(const uint64_t time_ms);
+	// Put everything written since begin_snapshot() out
+	void end_snapshot();
+
+	// Rows from here on are from table, with fields named by ids.
+	// csv gets a header the first time a table is written.
+	void begin_table(std::string_view table, const std::vector<std::string_view> &ids);
+	// Rows are written field by field, in the order of the ids
+	void begin_row();
+	void field(std::string_view value);
+	void end_row();
+private:
+	void write_quoted(std::string_view value);
+
+	enum batch_format format;
+	FILE *out;
+	uint64_t time_ms = 0;
+	std::string table;
+	// Tables a csv header was written for
+	std::unordered_set<std::string> headers;
+	// Column ids of the current table, for the jsonl keys
+	std::vector<std::string_view> ids;
+	// Written so far in the current row
+	uint32_t fields = 0;
+};
+
+#endif // BATCH_HPP_
@@ -0,0 +1,31 @@
+#include "cmdline_cache.hpp"
+
+const char *CmdlineCache::get(const struct process &p) {
+	auto it = entries.find(p.pid);
+	if (it != entries.end() && it->second.starttime == p.starttime && it->second.comm == p.name)
+		return strings.c_str(it->second.cmd);
+
+	struct entry &e = entries[p.pid];
+	e.starttime = p.starttime;
+	e.comm = p.name;
+	// Through the path, pid handles belong to the snapshot
+	struct pid_handle handle;
+	handle.pid = p.pid;
+	get_calling_command(&handle, &buffer, max_len);
+	e.cmd = strings.intern(buffer);
+	return strings.c_str(e.cmd);
+}
+
+void CmdlineCache::update(const ProcessSnapshot *snapshot) {
+	for (auto it = entries.begin(); it != entries.end();) {
+		const struct process_sample *sample = snapshot->find(it->first);
+		bool same_process = sample && sample->process.starttime == it->second.starttime;
+		bool same_image = sample && sample->process.name == it->second.comm;
+		if (!same_process || !same_image || snapshot->exec_seen(it->first))
+			it = entries.erase(it);
+		else
+			strings.touch((it++)->second.cmd);
+	}
+	// Command lines no entry refers to anymore
+	strings.sweep();
+}
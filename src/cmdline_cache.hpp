@@ -0,0 +1,44 @@
+#ifndef CMDLINE_CACHE_HPP_
+#define CMDLINE_CACHE_HPP_
+
+#include "proc.hpp"
+#include "string_arena.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+// Command lines of the processes that get displayed, read the first time
+// a row asks for one and kept until the process exits or execs.
+// An exec shows up as a new comm, or as an event with proc events enabled.
+// Identical command lines, like those of a pool of workers, are stored once.
+// Shared by all tabs, only used from the UI thread.
+class CmdlineCache {
+public:
+	// Command lines longer than max_len bytes are cut off
+	CmdlineCache(const size_t max_len = 4096) : max_len(max_len) {};
+	~CmdlineCache() {};
+
+	// Command line of p, read now if it isn't cached.
+	// Only valid until the next call.
+	const char *get(const struct process &p);
+	// Drop entries of processes that exited or exec'd, once per tick
+	void update(const ProcessSnapshot *snapshot);
+private:
+	struct entry {
+		uint64_t starttime = 0;
+		// Name when cmd was read, exec changes it
+		std::string comm = "";
+		uint32_t cmd = StringArena::EMPTY;
+	};
+
+	size_t max_len;
+	StringArena strings;
+	// Read buffer, kept to reuse its capacity
+	std::string buffer;
+
+	// Keyed by pid, the start time tells apart reused pids
+	std::unordered_map<uint64_t, struct entry> entries;
+};
+
+#endif // CMDLINE_CACHE_HPP_
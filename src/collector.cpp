@@ -0,0 +1,308 @@
+#include "collector.hpp"
+#include "stats.hpp"
+
+#include <algorithm> // std::sort
+#include <stdexcept>
+#include <cerrno>
+#include <cstring> // memcpy
+
+extern "C" {
+	#include <unistd.h> // sysconf()
+	#include <poll.h>
+	#include <sys/eventfd.h>
+	#include <sys/timerfd.h>
+}
+
+ProcessCollector::ProcessCollector(const unsigned jobs) : pool(jobs) {
+	ticks_per_s = sysconf(_SC_CLK_TCK);
+	page_size = sysconf(_SC_PAGESIZE);
+
+	ready_event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	stop_event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (ready_event == -1 || stop_event == -1)
+		throw std::runtime_error("eventfd() failed!");
+}
+
+ProcessCollector::~ProcessCollector() {
+	stop();
+	close(ready_event);
+	close(stop_event);
+}
+
+bool ProcessCollector::enable_proc_events() {
+	return events.open();
+}
+
+bool ProcessCollector::enable_taskstats() {
+	return taskstats.open();
+}
+
+void ProcessCollector::set_metrics(const uint32_t every_tick, const uint32_t full_tick) {
+	tick_metrics.store(every_tick | METRIC_STAT, std::memory_order_relaxed);
+	full_metrics.store(full_tick, std::memory_order_relaxed);
+}
+
+void ProcessCollector::update() {
+	// Whatever isn't listing or sorting pids is reading them
+	STAT_TIMER(PHASE_READ);
+	std::unique_ptr<struct snapshot_data> next;
+	{
+		std::lock_guard<std::mutex> guard(spares->lock);
+		if (!spares->free.empty()) {
+			next = std::move(spares->free.back());
+			spares->free.pop_back();
+		}
+	}
+	if (!next)
+		next = std::make_unique<struct snapshot_data>();
+
+	next->full = ticks++ % FULL_TICK_INTERVAL == 0;
+	next->groups = tick_metrics.load(std::memory_order_relaxed);
+	if (next->full)
+		next->groups |= full_metrics.load(std::memory_order_relaxed);
+	std::shared_ptr<const struct snapshot_data> previous = std::atomic_load(&published);
+	collect(next.get());
+	build_metrics(previous.get(), next.get());
+
+	// Whoever lets go of it last, the UI or the next update, gives it back
+	std::shared_ptr<const struct snapshot_data> snapshot(next.release(),
+		[spares = spares](const struct snapshot_data *data) {
+			std::unique_ptr<struct snapshot_data> buffer(const_cast<struct snapshot_data *>(data));
+			std::lock_guard<std::mutex> guard(spares->lock);
+			// More only pile up while the UI falls behind, those are freed
+			if (spares->free.size() < 2)
+				spares->free.push_back(std::move(buffer));
+		});
+	std::atomic_store(&published, snapshot);
+
+	uint64_t one = 1;
+	write(ready_event, &one, sizeof(one));
+}
+
+void ProcessCollector::clear_ready() {
+	uint64_t count;
+	read(ready_event, &count, sizeof(count));
+}
+
+void ProcessCollector::start(const uint32_t interval_ms) {
+	if (thread.joinable())
+		return;
+	timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (timer == -1)
+		throw std::runtime_error("timerfd_create() failed!");
+	// Periodic, ticks are spaced from their start and a slow /proc pass
+	// doesn't push the next one back
+	struct itimerspec spec = {};
+	spec.it_interval.tv_sec = interval_ms / 1000;
+	spec.it_interval.tv_nsec = (interval_ms % 1000) * 1000000L;
+	spec.it_value = spec.it_interval;
+	timerfd_settime(timer, 0, &spec, NULL);
+
+	thread = std::thread(&ProcessCollector::run, this);
+}
+
+void ProcessCollector::stop() {
+	if (!thread.joinable())
+		return;
+	uint64_t one = 1;
+	write(stop_event, &one, sizeof(one));
+	thread.join();
+
+	uint64_t count;
+	read(stop_event, &count, sizeof(count));
+	close(timer);
+	timer = -1;
+}
+
+void ProcessCollector::run() {
+	struct pollfd fds[2] = {
+		{timer, POLLIN, 0},
+		{stop_event, POLLIN, 0},
+	};
+	while (true) {
+		if (poll(fds, 2, -1) == -1) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+		if (fds[1].revents & POLLIN)
+			return;
+		// Expirations missed during a slow pass are dropped, not caught up on
+		uint64_t expirations;
+		if (read(timer, &expirations, sizeof(expirations)) == sizeof(expirations))
+			update();
+	}
+}
+
+// Everything but stat, which has been read already
+void ProcessCollector::read_sample(struct pid_handle *handle, const uint32_t metrics,
+								   struct process_sample *sample) const {
+	if (metrics & METRIC_STATM)
+		read_pid_statm(handle, &sample->statm);
+	if (metrics & METRIC_IO) {
+		// A reused pid read through its path is another process
+		if (handle->starttime != sample->stat.starttime)
+			handle->io = IO_UNDECIDED;
+		// Taskstats leaves out the io of exited threads and reaped children,
+		// which procfs counts. It's only picked for processes that have had
+		// neither so far, and they keep it as long as they have one thread.
+		if (handle->io == IO_UNDECIDED)
+			handle->io = taskstats.is_open() && sample->stat.num_threads == 1
+				&& !sample->stat.cutime && !sample->stat.cstime ? IO_TASKSTATS : IO_PROCFS;
+		if (handle->io == IO_TASKSTATS && (sample->stat.num_threads != 1
+				|| !taskstats.read_io(handle->pid, &sample->io))) {
+			// On to procfs for good, its total isn't comparable to the last one
+			handle->io = IO_PROCFS;
+			sample->io_rebased = true;
+		}
+		if (handle->io == IO_PROCFS)
+			read_pid_io(handle, &sample->io);
+	}
+	// Swap is all the tabs take from it so far
+	if (metrics & METRIC_STATUS)
+		read_pid_status(handle, STATUS_MEM, &sample->status);
+
+	struct process &p = sample->process;
+	p.pid = handle->pid;
+	p.starttime = sample->stat.starttime;
+	p.is_alive = true;
+	memcpy(p.name, sample->stat.comm, sample->stat.comm_len + 1);
+}
+
+void ProcessCollector::collect(struct snapshot_data *data) {
+	pids.clear();
+	data->changed.clear();
+	{
+		STAT_TIMER(PHASE_SCAN);
+		if (events.is_open()) {
+			events.update(&pids);
+			data->changed = events.get_changed();
+		} else {
+			find_processes(&pids);
+		}
+	}
+
+	get_uptime(&data->uptime);
+	data->timestamp_ns = monotonic_ns();
+
+	// The handle cache isn't thread safe, open everything before fanning out
+	pid_handles.resize(pids.size());
+	for (size_t i = 0; i < pids.size(); i++)
+		pid_handles[i] = handles.get(pids[i]);
+
+	// Every worker only writes the slot of the pid it's reading
+	std::vector<struct process_sample> &processes = data->processes;
+	processes.clear();
+	processes.resize(pids.size());
+	read_ok.assign(pids.size(), false);
+	const uint32_t metrics = data->groups;
+	pool.for_each(pids.size(), [&](size_t i) {
+		read_ok[i] = read_pid_stat(pid_handles[i], &processes[i].stat);
+		if (read_ok[i])
+			read_sample(pid_handles[i], metrics, &processes[i]);
+	});
+
+	keys.clear();
+	size_t alive = 0;
+	for (size_t i = 0; i < pids.size(); i++) {
+		struct process_sample &sample = processes[i];
+		struct pid_handle *handle = pid_handles[i];
+		if (!read_ok[i]) {
+			// A cached handle goes stale when its process exits, the pid may be reused
+			handle = handles.reopen(pids[i]);
+			if (!read_pid_stat(handle, &sample.stat)) {
+				// Exited since readdir, or since the events listed it
+				handles.evict(pids[i]);
+				// It would be read and fail again every tick until the next rescan
+				if (events.is_open())
+					events.forget(pids[i]);
+				continue;
+			}
+			read_sample(handle, metrics, &sample);
+		}
+		handle->starttime = sample.stat.starttime;
+
+		keys.push_back({sample.process.pid, sample.process.starttime});
+		if (alive != i)
+			processes[alive] = std::move(sample);
+		alive++;
+	}
+	processes.resize(alive);
+	// Close the handles of processes that exited
+	handles.reconcile(keys);
+
+	// readdir doesn't guarantee any order
+	STAT_TIMER(PHASE_SORT);
+	std::sort(processes.begin(), processes.end(),
+		[](const struct process_sample &a, const struct process_sample &b) {
+			return a.process.pid < b.process.pid;
+		});
+}
+
+// Change of a counter per second, 0 if it went backwards
+static float rate(const uint64_t now, const uint64_t before, const double seconds) {
+	if (now < before || seconds <= 0)
+		return 0;
+	return (now - before) / seconds;
+}
+
+void ProcessCollector::build_metrics(const struct snapshot_data *previous, struct snapshot_data *data) const {
+	const std::vector<struct process_sample> &processes = data->processes;
+	struct process_metrics &m = data->metrics;
+	m.resize(processes.size());
+	for (size_t i = 0; i < processes.size(); i++) {
+		const struct process_sample &sample = processes[i];
+		m.pid[i] = sample.process.pid;
+		m.starttime[i] = sample.process.starttime;
+		m.utime[i] = sample.stat.utime;
+		m.stime[i] = sample.stat.stime;
+		m.rss[i] = sample.stat.rss * page_size;
+		m.vsize[i] = sample.stat.vsize;
+		m.read_bytes[i] = sample.io.read_bytes;
+		m.write_bytes[i] = sample.io.write_bytes;
+	}
+
+	const bool io_read = data->groups & METRIC_IO;
+	static const struct process_metrics none;
+	const struct process_metrics &prev = previous ? previous->metrics : none;
+	const double interval = previous ? (data->timestamp_ns - previous->timestamp_ns) / 1000000000.0 : 0;
+	// Both are sorted by pid, matching them up is a single merge pass
+	size_t j = 0;
+	for (size_t i = 0; i < m.size(); i++) {
+		while (j < prev.size() && prev.pid[j] < m.pid[i])
+			j++;
+		bool seen = j < prev.size() && prev.pid[j] == m.pid[i] && prev.starttime[j] == m.starttime[i];
+		// New processes are averaged over their lifetime so far
+		uint64_t started = m.starttime[i] / ticks_per_s;
+		double lifetime = data->uptime > started ? data->uptime - started : 1;
+
+		uint64_t cpu_ticks = m.utime[i] + m.stime[i];
+		if (seen)
+			m.cpu_usage[i] = rate(cpu_ticks, prev.utime[j] + prev.stime[j], interval) / ticks_per_s * 100;
+		else
+			m.cpu_usage[i] = rate(cpu_ticks, 0, lifetime) / ticks_per_s * 100;
+
+		if (!io_read) {
+			// Keep the last known counters until io is read again
+			m.read_bytes[i] = seen ? prev.read_bytes[j] : 0;
+			m.write_bytes[i] = seen ? prev.write_bytes[j] : 0;
+			m.io_ns[i] = seen ? prev.io_ns[j] : 0;
+			m.read_per_s[i] = seen ? prev.read_per_s[j] : 0;
+			m.write_per_s[i] = seen ? prev.write_per_s[j] : 0;
+			continue;
+		}
+		m.io_ns[i] = data->timestamp_ns;
+		if (seen && processes[i].io_rebased) {
+			// Counters switched source, the last rates are the best guess for this tick
+			m.read_per_s[i] = prev.read_per_s[j];
+			m.write_per_s[i] = prev.write_per_s[j];
+		} else if (seen && prev.io_ns[j]) {
+			double io_interval = (m.io_ns[i] - prev.io_ns[j]) / 1000000000.0;
+			m.read_per_s[i] = rate(m.read_bytes[i], prev.read_bytes[j], io_interval);
+			m.write_per_s[i] = rate(m.write_bytes[i], prev.write_bytes[j], io_interval);
+		} else {
+			m.read_per_s[i] = rate(m.read_bytes[i], 0, lifetime);
+			m.write_per_s[i] = rate(m.write_bytes[i], 0, lifetime);
+		}
+	}
+}
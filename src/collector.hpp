@@ -0,0 +1,119 @@
+#ifndef COLLECTOR_HPP_
+#define COLLECTOR_HPP_
+
+#include "proc.hpp"
+#include "pid_handle.hpp"
+#include "worker_pool.hpp"
+#include "proc_events.hpp"
+
+#include <vector>
+#include <memory> // shared_ptr
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// Every this many ticks the hidden tabs' metrics are collected too
+#define FULL_TICK_INTERVAL	5
+
+// Snapshots no reader holds anymore, kept for the collector to refill.
+// A snapshot's shared_ptr puts it back when its last reference is dropped,
+// the reference count orders the readers' last access before that and the
+// lock orders it before the reuse.
+struct snapshot_pool {
+	std::mutex lock;
+	std::vector<std::unique_ptr<struct snapshot_data>> free;
+};
+
+/* Reads /proc once per tick, on a thread of its own once started, and
+ * publishes every result as an immutable snapshot_data through an atomic
+ * shared_ptr swap. Readers keep the snapshot they loaded alive for as long
+ * as they need it, the collector moves on to a fresh one. Whoever drops
+ * the last reference to a snapshot hands it back to a pool the collector
+ * refills from, so two buffers are enough unless the UI falls behind.
+ * Only the metric groups of the visible tab are read on every tick, the ones
+ * of hidden tabs on every FULL_TICK_INTERVAL'th tick, so their rates stay
+ * current without paying for everything every tick.
+ * Ticks come from a timerfd, every publish makes ready_fd() readable so the
+ * UI can wait for snapshots in the same poll() as for input.
+ * Pid handles, proc events and taskstats are only touched by the collecting
+ * thread.
+ */
+class ProcessCollector {
+public:
+	// jobs is the number of threads reading pids, 0 picks one per core
+	ProcessCollector(const unsigned jobs = 1);
+	~ProcessCollector();
+
+	// Track pids through proc connector events instead of a readdir of /proc
+	// per tick, false if the kernel doesn't provide them
+	bool enable_proc_events();
+	// Read io counters of single threaded processes through taskstats,
+	// false if the kernel doesn't provide them
+	bool enable_taskstats();
+	// Metric groups to collect on every tick and the extra ones for full ticks.
+	// Takes effect from the next tick, safe to call from any thread.
+	void set_metrics(const uint32_t every_tick, const uint32_t full_tick);
+
+	// Collect and publish one snapshot on the calling thread.
+	// Not to be called while the collector thread is running.
+	void update();
+	// Call update() every interval_ms on a thread of its own
+	void start(const uint32_t interval_ms);
+	// Stop the collector thread, waits for an update in progress
+	void stop();
+
+	// Readable once a snapshot was published since the last clear_ready()
+	int ready_fd() const {
+		return ready_event;
+	}
+	void clear_ready();
+
+	// Last published snapshot, nullptr before the first update.
+	// Safe to call from any thread.
+	std::shared_ptr<const struct snapshot_data> latest() const {
+		return std::atomic_load(&published);
+	}
+private:
+	// Walk /proc once and read the metric groups of data->groups for every pid
+	void collect(struct snapshot_data *data);
+	// Everything but stat, which has been read already
+	void read_sample(struct pid_handle *handle, const uint32_t metrics,
+					 struct process_sample *sample) const;
+	// Fill data->metrics from its samples, rates are against previous
+	void build_metrics(const struct snapshot_data *previous, struct snapshot_data *data) const;
+	void run();
+
+	PidHandleCache handles;
+	WorkerPool pool;
+	ProcEvents events;
+	TaskstatsSource taskstats;
+
+	uint32_t ticks_per_s = 0;
+	uint32_t page_size = 0;
+
+	std::atomic<uint32_t> tick_metrics{METRIC_ALL};
+	std::atomic<uint32_t> full_metrics{METRIC_ALL};
+	uint32_t ticks = 0;
+
+	std::shared_ptr<const struct snapshot_data> published;
+	// Shared with the deleters of published snapshots, which may outlive the collector
+	std::shared_ptr<struct snapshot_pool> spares = std::make_shared<struct snapshot_pool>();
+
+	std::thread thread;
+	// Periodic timer driving run()
+	int timer = -1;
+	// Written by stop() to end run()
+	int stop_event = -1;
+	// Written after every publish
+	int ready_event = -1;
+
+	// Scratch buffers, kept to reuse their capacity
+	std::vector<int32_t> pids;
+	std::vector<struct pid_handle *> pid_handles;
+	// Not vector<bool>, workers write neighbouring entries at the same time
+	std::vector<uint8_t> read_ok;
+	std::vector<struct pid_key> keys;
+};
+
+#endif // COLLECTOR_HPP_
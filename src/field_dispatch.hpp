@@ -0,0 +1,173 @@
+#ifndef FIELD_DISPATCH_HPP_
+#define FIELD_DISPATCH_HPP_
+
+#include "parse.hpp"
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/* Key -> member dispatch for "Key: value" procfs files.
+ * Each file gets a single table of {key, parser} entries, the parser
+ * knows which member to write and how to decode it. A perfect hash is
+ * searched for at compile time, so a lookup is one hash and one compare.
+ */
+
+template<typename T>
+struct field {
+	std::string_view key = {};
+	void (*parse)(T *obj, std::string_view value) = nullptr;
+	// Groups the field belongs to, skipped unless one of them is asked for
+	uint32_t groups = ~0u;
+};
+
+inline void parse_value(std::string_view value, std::string *out) {
+	out->assign(value.data(), value.size());
+}
+
+// First character, like the state letter of "S (sleeping)"
+inline void parse_value(std::string_view value, char *out) {
+	*out = value.empty() ? 0 : value[0];
+}
+
+inline void parse_value(std::string_view value, double *out) {
+	std::from_chars(value.data(), value.data() + value.size(), *out);
+}
+
+// Trailing units like " kB" are ignored
+template<typename T>
+inline void parse_value(std::string_view value, T *out) {
+	const char *cur = value.data();
+	scan_int(cur, value.data() + value.size(), out);
+}
+
+// Blank separated columns, like the ids of "Uid:\t0\t0\t0\t0"
+template<typename T, size_t N>
+inline void parse_value(std::string_view value, T (*out)[N]) {
+	const char *cur = value.data();
+	for (size_t i = 0; i < N; i++)
+		if (!scan_int(cur, value.data() + value.size(), &(*out)[i]))
+			return;
+}
+
+template<typename M>
+struct member_of;
+template<typename C, typename M>
+struct member_of<M C::*> {
+	typedef C owner;
+};
+
+template<auto Member>
+void parse_member(typename member_of<decltype(Member)>::owner *obj, std::string_view value) {
+	parse_value(value, &(obj->*Member));
+}
+
+// Octal or hex integers, like umasks and signal masks
+template<auto Member, int Base>
+void parse_member_base(typename member_of<decltype(Member)>::owner *obj, std::string_view value) {
+	std::from_chars(value.data(), value.data() + value.size(), obj->*Member, Base);
+}
+
+#define FIELD(type, member, key)	field<type>{ key, &parse_member<&type::member> }
+#define GROUP_FIELD(type, member, key, groups)	field<type>{ key, &parse_member<&type::member>, groups }
+#define GROUP_FIELD_BASE(type, member, key, groups, base) \
+	field<type>{ key, &parse_member_base<&type::member, base>, groups }
+
+constexpr uint32_t field_hash(std::string_view key, uint32_t seed) {
+	// FNV-1a with a murmur finalizer, the low bits are used as the slot
+	uint32_t h = 2166136261u ^ seed;
+	for (char c : key) {
+		h ^= static_cast<uint8_t>(c);
+		h *= 16777619u;
+	}
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+	return h;
+}
+
+template<typename T, size_t N>
+class FieldTable {
+public:
+	constexpr FieldTable(const field<T> (&table)[N]) {
+		for (size_t i = 0; i < N; i++)
+			fields[i] = table[i];
+
+		for (uint32_t s = 1; s < MAX_SEEDS; s++) {
+			if (try_seed(s)) {
+				seed = s;
+				return;
+			}
+		}
+	}
+
+	// False if no perfect hash was found, checked with static_assert
+	constexpr bool valid() const {
+		return seed != 0;
+	}
+
+	// Number of fields in any of groups
+	constexpr size_t count(uint32_t groups) const {
+		size_t n = 0;
+		for (size_t i = 0; i < N; i++)
+			if (fields[i].groups & groups)
+				n++;
+		return n;
+	}
+
+	// Parse value into the member behind key, false if key is unknown
+	// or not in groups
+	bool parse(T *obj, std::string_view key, std::string_view value, uint32_t groups = ~0u) const {
+		uint16_t slot = slots[field_hash(key, seed) & (SIZE - 1)];
+		if (slot == EMPTY || fields[slot].key != key || !(fields[slot].groups & groups))
+			return false;
+		fields[slot].parse(obj, value);
+		return true;
+	}
+private:
+	static constexpr size_t table_size() {
+		// At most 1/4 full, so a seed without collisions turns up quickly
+		size_t size = 8;
+		while (size < N * 4)
+			size <<= 1;
+		return size;
+	}
+
+	constexpr bool try_seed(uint32_t s) {
+		for (size_t i = 0; i < SIZE; i++)
+			slots[i] = EMPTY;
+		for (size_t i = 0; i < N; i++) {
+			uint16_t &slot = slots[field_hash(fields[i].key, s) & (SIZE - 1)];
+			if (slot != EMPTY)
+				return false;
+			slot = i;
+		}
+		return true;
+	}
+
+	static constexpr size_t SIZE = table_size();
+	static constexpr uint16_t EMPTY = 0xFFFF;
+	static constexpr uint32_t MAX_SEEDS = 100000;
+
+	field<T> fields[N] = {};
+	uint16_t slots[SIZE] = {};
+	uint32_t seed = 0;
+};
+
+// Split "key<sep>value" and dispatch it, value has its leading blanks trimmed
+template<typename T, size_t N>
+inline bool dispatch_line(const FieldTable<T, N> &table, T *obj, std::string_view line,
+						  const char *key_end_chars, uint32_t groups = ~0u) {
+	size_t key_end = line.find_first_of(key_end_chars);
+	size_t colon = line.find(':', key_end);
+	if (key_end == std::string_view::npos || colon == std::string_view::npos)
+		return false;
+
+	std::string_view value = line.substr(colon + 1);
+	size_t value_start = value.find_first_not_of(" \t");
+	value = value_start == std::string_view::npos ? std::string_view() : value.substr(value_start);
+	return table.parse(obj, line.substr(0, key_end), value, groups);
+}
+
+#endif // FIELD_DISPATCH_HPP_
@@ -1,6 +1,10 @@
 #include "util.hpp"
 #include "ncurs.hpp"
 #include "proc.hpp"
+#include "collector.hpp"
+#include "cmdline_cache.hpp"
+#include "stats.hpp"
+#include "batch.hpp"
 
 #include "navbar.hpp"
 #include "tabs/overview.hpp"
@@ -10,6 +14,15 @@
 #include "tabs/disk.hpp"
 #include "tabs/net.hpp"
 
+extern "C" {
+	#include <poll.h>
+	#include <unistd.h> // STDIN_FILENO
+}
+
+#include <cerrno>
+#include <csignal>
+#include <chrono>
+
 extern bool quit;
 
 inline void hide_all_panels(std::vector<Tab *> tabs) {
@@ -17,6 +30,16 @@ inline void hide_all_panels(std::vector<Tab *> tabs) {
 		hide_panel(t->get_panel());
 }
 
+// Collect everything the selected tab needs on every tick and what the
+// others need on full ticks
+void select_tab_metrics(ProcessCollector *collector, Tab *selected, const std::vector<Tab *> &tabs) {
+	uint32_t hidden = 0;
+	for (Tab *t : tabs)
+		if (t != selected)
+			hidden |= t->get_metrics();
+	collector->set_metrics(selected->get_metrics(), hidden);
+}
+
 void select_tab_panel(Tab * tab, std::vector<Tab *> tabs) {
 	if (!panel_hidden(tab->get_panel()))
 		return;
@@ -27,24 +50,103 @@ void select_tab_panel(Tab * tab, std::vector<Tab *> tabs) {
 	update_panels();
 }
 
+// Write the process tables of every snapshot to stdout, until batch_count
+// of them are out or a signal comes in
+void run_batch(ProcessCollector *collector, ProcessSnapshot *snapshot, CmdlineCache *cmdlines, const int signal_fd) {
+	CPU cpu_tab(snapshot, cmdlines);
+	GPU gpu_tab(snapshot, cmdlines);
+	MEM mem_tab(snapshot, cmdlines);
+	DISK disk_tab(snapshot, cmdlines);
+	NET net_tab(snapshot, cmdlines);
+	std::vector<Tab *> tabs = {&cpu_tab, &gpu_tab, &mem_tab, &disk_tab, &net_tab};
+
+	// Every table is written on every tick
+	uint32_t metrics = 0;
+	for (Tab *t : tabs)
+		metrics |= t->get_metrics();
+	collector->set_metrics(metrics, 0);
+	collector->start(update_interval_ms);
+
+	BatchWriter out(batch_format);
+	uint32_t written = 0;
+	struct pollfd fds[2] = {
+		{collector->ready_fd(), POLLIN, 0},
+		{signal_fd, POLLIN, 0},
+	};
+	while (!quit && (!batch_count || written < batch_count)) {
+		if (poll(fds, 2, -1) == -1) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		if (fds[1].revents & POLLIN) {
+			// There's no terminal to fit, only SIGINT and SIGTERM matter
+			int signo;
+			while ((signo = read_signal(signal_fd)))
+				if (signo != SIGWINCH)
+					quit = true;
+		}
+		if (!(fds[0].revents & POLLIN) || quit)
+			continue;
+		collector->clear_ready();
+		if (!snapshot->refresh(collector->latest()))
+			continue;
+
+		cmdlines->update(snapshot);
+		auto now = std::chrono::system_clock::now().time_since_epoch();
+		out.begin_snapshot(std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+		for (Tab *t : tabs) {
+			t->collect();
+			t->write_batch(&out);
+		}
+		out.end_snapshot();
+		written++;
+	}
+}
+
 int main(int argc, char *argv[]) {
-	setup_signal_handler();
+	// Before the collector's threads start, they inherit the blocked signals
+	int signal_fd = setup_signal_fd();
 	check_root();
 	read_args(argc, argv);
 
-	ncurses_init();
-
-	std::vector<struct process> processes;
-	find_processes(&processes);
+	if (batch)
+		ncurses_init_headless();
+	else
+		ncurses_init();
+
+	// One /proc pass per tick, shared by all tabs
+	ProcessCollector collector(jobs);
+	// Falls back to reading /proc every tick if events aren't available
+	if (proc_events)
+		collector.enable_proc_events();
+	// Same for taskstats, the text files are read instead
+	if (use_taskstats)
+		collector.enable_taskstats();
+	// First one on this thread, so the tabs start out with data
+	collector.update();
+	ProcessSnapshot snapshot;
+	snapshot.refresh(collector.latest());
+
+	// Command lines are only read for rows on screen
+	CmdlineCache cmdlines(cmdline_max);
+
+	if (batch) {
+		run_batch(&collector, &snapshot, &cmdlines, signal_fd);
+		collector.stop();
+		ncurses_fini();
+		return 0;
+	}
 
 	Navbar nav;
 
-	Overview overview_tab;
-	CPU cpu_tab;
-	GPU gpu_tab;
-	MEM mem_tab;
-	DISK disk_tab;
-	NET net_tab;
+	Overview overview_tab(&snapshot, &cmdlines);
+	CPU cpu_tab(&snapshot, &cmdlines);
+	GPU gpu_tab(&snapshot, &cmdlines);
+	MEM mem_tab(&snapshot, &cmdlines);
+	DISK disk_tab(&snapshot, &cmdlines);
+	NET net_tab(&snapshot, &cmdlines);
 
 	std::vector<Tab *> tabs;
 	tabs.push_back(&overview_tab);
@@ -53,22 +155,87 @@ int main(int argc, char *argv[]) {
 	tabs.push_back(&mem_tab);
 	tabs.push_back(&disk_tab);
 	tabs.push_back(&net_tab);
+	for (Tab *t : tabs) {
+		t->probe();
+		t->collect();
+		t->update();
+	}
 	hide_all_panels(tabs);
 
-	Tab *selected_tab = nullptr;
+	// Sampling goes on in the background, the loop below only draws
+	Tab *selected_tab = tabs.at(nav.pos);
+	select_tab_metrics(&collector, selected_tab, tabs);
+	collector.start(update_interval_ms);
+
+	select_tab_panel(selected_tab, tabs);
+	ncurses_draw_frame(&nav);
+	// Sleeps until a key, a snapshot or a signal comes in, and only draws then
+	struct pollfd fds[3] = {
+		{STDIN_FILENO, POLLIN, 0},
+		{collector.ready_fd(), POLLIN, 0},
+		{signal_fd, POLLIN, 0},
+	};
 	while (!quit) {
-		selected_tab = tabs.at(nav.pos);
-		select_tab_panel(selected_tab, tabs);
-
-		wrefresh(selected_tab->get_window());
-
-		ncurses_check_keyboard(&nav, selected_tab);
-
+		if (poll(fds, 3, -1) == -1) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		bool redraw = false;
+
+		if (fds[2].revents & POLLIN) {
+			int signo;
+			while ((signo = read_signal(signal_fd))) {
+				if (signo == SIGWINCH) {
+					ncurses_resize(tabs);
+					redraw = true;
+				} else {
+					quit = true;
+				}
+			}
+		}
+
+		if (fds[0].revents & POLLIN) {
+			// Everything typed since the last frame, a key may switch tabs
+			// for the ones after it
+			while (ncurses_check_keyboard(&nav, selected_tab, &snapshot)) {
+				redraw = true;
+				if (selected_tab != tabs.at(nav.pos)) {
+					selected_tab = tabs.at(nav.pos);
+					select_tab_panel(selected_tab, tabs);
+					select_tab_metrics(&collector, selected_tab, tabs);
+				}
+			}
+		}
+
+		if (fds[1].revents & POLLIN) {
+			collector.clear_ready();
+			if (snapshot.refresh(collector.latest())) {
+				cmdlines.update(&snapshot);
+				for (Tab *t : tabs)
+					if ((t == selected_tab || snapshot.is_full()) && snapshot.has_metrics(t->get_metrics()))
+						t->collect();
+				ncurses_draw_costs(&nav, &snapshot);
+				redraw = true;
+			}
+		}
+
+		if (!redraw || quit)
+			continue;
+		STAT_TIMER(PHASE_RENDER);
 		selected_tab->update();
+		ncurses_draw_frame(&nav);
 	}
+	collector.stop();
 
 	ncurses_fini();
 
+	if (count_frame_bytes) {
+		const struct frame_stats &stats = ncurses_frame_stats();
+		std::cout << "Frames: " << stats.frames << ", bytes written: " << stats.bytes
+			<< ", per frame: " << (stats.frames ? stats.bytes / stats.frames : 0)
+			<< ", max: " << stats.max_bytes << std::endl;
+	}
 	std::cout << "Quitting properly" << std::endl;
 
 	return 0;
@@ -38,6 +38,16 @@ void Navbar::deselect_tab(int p) {
 	mvwprintw(navbar, 0, tab_offsets[p], " %s ", tabs[p].c_str());
 }
 
+void Navbar::set_status(const std::string &text) {
+	int offset = tab_offsets.back() + tabs.back().size() + 3;
+	wattroff(navbar, A_REVERSE);
+	wmove(navbar, 0, offset);
+	wclrtoeol(navbar);
+	int room = getmaxx(navbar) - offset;
+	if (room > 0)
+		waddnstr(navbar, text.c_str(), room);
+}
+
 void Navbar::move_right() {
 	deselect_tab(pos);
 	pos = (pos + 1) % tabs.size();
@@ -16,6 +16,8 @@ public:
     int pos = 0;
     void move_right();
     void move_left();
+    // Text right of the tab names, cut off at the edge of the terminal
+    void set_status(const std::string &text);
 
     std::vector<std::string> get_tabs() {
         return tabs;
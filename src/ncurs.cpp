@@ -1,18 +1,26 @@
 #include "ncurs.hpp"
 
+#include "util.hpp"
+#include "stats.hpp"
+
 #include <iostream>
 #include <vector>
+#include <algorithm> // std::max
+#include <stdexcept>
+#include <cstdio> // fopen()
 #include <signal.h>
 
 extern "C" {
 	#include <ncurses.h> //GUI
+	#include <unistd.h> // STDOUT_FILENO
+	#include <sys/ioctl.h> // TIOCGWINSZ
 }
 
 extern bool quit;
 extern bool lock;
 
-// 1s
-#define UPDATE_INTERVAL_MS	(1000)
+// Overlay of the last tick, kept while it's hidden so o shows it right away
+static std::string costs;
 
 void ncurses_init() {
 	// init screen and sets up screen
@@ -21,18 +29,28 @@ void ncurses_init() {
 	noecho();
 	// Hide cursor
 	curs_set(0);
-	// Wait a UPDATE_INTERVAL_MS ms for key press
-	timeout(UPDATE_INTERVAL_MS);
+	// Keys are read once poll() says there are some
+	nodelay(stdscr, TRUE);
 	// Enable arrow keys
 	keypad(stdscr, TRUE);
 	// Allow scrolling
 	scrollok(stdscr, TRUE);
 }
 
-void ncurses_check_keyboard(Navbar *navbar, Tab *current_tab) {
+void ncurses_init_headless() {
+	// stdout is for the batch output and there might be no terminal at all
+	FILE *null = fopen("/dev/null", "r+");
+	if (!null)
+		throw std::runtime_error("fopen() failed!");
+	// Plain enough to be in every terminfo database
+	if (!newterm("dumb", null, null))
+		throw std::runtime_error("newterm() failed!");
+}
+
+bool ncurses_check_keyboard(Navbar *navbar, Tab *current_tab, const ProcessSnapshot *snapshot) {
     std::vector<std::string> tabs = navbar->get_tabs();
     std::vector<int> tab_offsets = navbar->get_tab_offsets();
-	// Has a timeout UPDATE_INTERVAL_MS
+	// Never waits, tab windows are in nodelay mode
 	int character = wgetch(current_tab->get_window());
 	switch (character)
 	{
@@ -42,15 +60,17 @@ void ncurses_check_keyboard(Navbar *navbar, Tab *current_tab) {
 		case 'l':
 			lock = !lock;
 			break;
+		case 'o':
+			show_costs = !show_costs;
+			navbar->set_status(show_costs ? costs : "");
+			break;
 		case 'k':
-			kill (current_tab->get_pid_at_pos(), SIGKILL);
+			snapshot->send_signal(current_tab->get_pid_at_pos(), SIGKILL);
 			current_tab->proc_up();
-			wrefresh(current_tab->get_window());
 			break;
 		case 'i':
-			kill (current_tab->get_pid_at_pos(), SIGINT);
+			snapshot->send_signal(current_tab->get_pid_at_pos(), SIGINT);
 			current_tab->proc_up();
-			wrefresh(current_tab->get_window());
 			break;
 		case '2':
 		case KEY_RIGHT:
@@ -71,8 +91,84 @@ void ncurses_check_keyboard(Navbar *navbar, Tab *current_tab) {
 		default:
 			break;
 	}
-	// Refresh navbar window
-	wrefresh(navbar->get_navbar());
+	return character != ERR;
+}
+
+void ncurses_resize(const std::vector<Tab *> &tabs) {
+	struct winsize size;
+	if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == -1)
+		return;
+	resizeterm(size.ws_row, size.ws_col);
+	for (Tab *t : tabs)
+		t->resize(size.ws_row, size.ws_col);
+	// The next doupdate() repaints the whole terminal
+	clearok(curscr, TRUE);
+}
+
+static struct frame_stats stats;
+
+static uint64_t terminal_bytes() {
+	// Only this thread writes to the terminal
+	struct pid_io io;
+	read_thread_io(&io);
+	return io.wchar;
+}
+
+void ncurses_draw_frame(Navbar *navbar) {
+	update_panels();
+	wnoutrefresh(navbar->get_navbar());
+	if (!count_frame_bytes) {
+		doupdate();
+		return;
+	}
+
+	uint64_t before = terminal_bytes();
+	doupdate();
+	stats.last_bytes = terminal_bytes() - before;
+	stats.bytes += stats.last_bytes;
+	stats.max_bytes = std::max(stats.max_bytes, stats.last_bytes);
+	stats.frames++;
+}
+
+void ncurses_draw_costs(Navbar *navbar, const ProcessSnapshot *snapshot) {
+	static struct cost_sample last;
+	struct cost_sample now;
+	read_stats(&now);
+	// Everything since the previous snapshot, the collector's tick and the
+	// frames drawn for it
+	struct cost_sample tick;
+	for (int i = 0; i < PHASE_COUNT; i++)
+		tick.phase_ns[i] = now.phase_ns[i] - last.phase_ns[i];
+	tick.syscalls = now.syscalls - last.syscalls;
+	tick.bytes_read = now.bytes_read - last.bytes_read;
+	tick.allocations = now.allocations - last.allocations;
+	last = now;
+
+	char buf[256] = "";
+	int len = 0;
+	if (stats_enabled()) {
+		len = snprintf(buf, sizeof(buf),
+			"scan %.1f read %.1f sort %.1f sys %.1f draw %.1fms | %lu calls %sB read %lu new | ",
+			tick.phase_ns[PHASE_SCAN] / 1e6, tick.phase_ns[PHASE_READ] / 1e6,
+			tick.phase_ns[PHASE_SORT] / 1e6, tick.phase_ns[PHASE_SYS] / 1e6,
+			tick.phase_ns[PHASE_RENDER] / 1e6, tick.syscalls,
+			format_size(tick.bytes_read).c_str(), tick.allocations);
+	}
+	// The collector already sampled glimpse along with everything else
+	const struct process_sample *self = snapshot->find(getpid());
+	if (self) {
+		const struct process_metrics &metrics = snapshot->get_process_metrics();
+		size_t i = snapshot->index_of(self);
+		snprintf(buf + len, sizeof(buf) - len, "rss %sB cpu %.1f%%",
+			format_size(metrics.rss[i]).c_str(), (double)metrics.cpu_usage[i]);
+	}
+	costs = buf;
+	if (show_costs)
+		navbar->set_status(costs);
+}
+
+const struct frame_stats &ncurses_frame_stats() {
+	return stats;
 }
 
 void ncurses_fini() {
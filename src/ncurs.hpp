@@ -3,9 +3,29 @@
 
 #include "navbar.hpp"
 #include "tabs/tab.hpp"
+#include "proc.hpp"
+
+// Terminal output of the frames drawn so far, with -b
+struct frame_stats {
+	uint64_t frames = 0;
+	// Bytes written to the terminal
+	uint64_t bytes = 0;
+	uint64_t last_bytes = 0;
+	uint64_t max_bytes = 0;
+};
 
 void ncurses_init();
-void ncurses_check_keyboard(Navbar *navbar, Tab *current_tab);
+// Screen for batch mode, the tabs draw into windows that never get shown
+void ncurses_init_headless();
+// Handle one keypress, false if there was none waiting
+bool ncurses_check_keyboard(Navbar *navbar, Tab *current_tab, const ProcessSnapshot *snapshot);
+// Fit the tabs to the terminal after a SIGWINCH
+void ncurses_resize(const std::vector<Tab *> &tabs);
+// Put what changed in the panels and the navbar on the terminal, in a single doupdate()
+void ncurses_draw_frame(Navbar *navbar);
+// Work out what the tick behind snapshot cost, put on the navbar with show_costs
+void ncurses_draw_costs(Navbar *navbar, const ProcessSnapshot *snapshot);
+const struct frame_stats &ncurses_frame_stats();
 void ncurses_fini();
 
 #endif // NCURS_HPP_
\ No newline at end of file
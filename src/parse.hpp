@@ -0,0 +1,63 @@
+#ifndef PARSE_HPP_
+#define PARSE_HPP_
+
+#include <charconv> // std::from_chars
+#include <string>
+#include <string_view>
+#include <cstring> // memchr
+#include <cstdint>
+#include <cstddef>
+
+extern "C" {
+	#include <sys/types.h> // ssize_t
+}
+
+// Allocation free helpers for parsing procfs text
+
+// Read up to size bytes of a file with a single read(), -1 on failure
+ssize_t read_file(const char *path, char *buf, size_t size);
+// Read a whole file of any size, reusing buf's capacity
+bool read_file(const char *path, std::string *buf);
+
+// Take the next line off [cur, end) without its '\n', false at the end
+inline bool next_line(const char *&cur, const char *end, std::string_view *line) {
+	if (cur >= end)
+		return false;
+	const char *nl = static_cast<const char *>(memchr(cur, '\n', end - cur));
+	const char *line_end = nl ? nl : end;
+	*line = std::string_view(cur, line_end - cur);
+	cur = nl ? nl + 1 : end;
+	return true;
+}
+
+inline const char *skip_spaces(const char *cur, const char *end) {
+	while (cur < end && (*cur == ' ' || *cur == '\t'))
+		cur++;
+	return cur;
+}
+
+// Skip leading blanks and decode the next integer, moving cur past it.
+// Negative values are stored two's complement, like operator>> did.
+template<typename T>
+inline bool scan_int(const char *&cur, const char *end, T *value) {
+	cur = skip_spaces(cur, end);
+	if (cur < end && *cur == '-') {
+		int64_t v = 0;
+		std::from_chars_result res = std::from_chars(cur, end, v);
+		if (res.ec != std::errc())
+			return false;
+		*value = static_cast<T>(v);
+		cur = res.ptr;
+		return true;
+	}
+
+	uint64_t v = 0;
+	std::from_chars_result res = std::from_chars(cur, end, v);
+	if (res.ec != std::errc())
+		return false;
+	*value = static_cast<T>(v);
+	cur = res.ptr;
+	return true;
+}
+
+#endif // PARSE_HPP_
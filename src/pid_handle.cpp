@@ -0,0 +1,136 @@
+#include "pid_handle.hpp"
+#include "parse.hpp"
+#include "stats.hpp"
+
+#include <cstdio> // snprintf
+#include <cerrno>
+
+extern "C" {
+	#include <unistd.h> // close(), read()
+	#include <sys/resource.h> // setrlimit()
+}
+
+int open_pid_file(const struct pid_handle *handle, const char *name, const int flags) {
+	if (handle->dirfd != -1)
+		return openat(handle->dirfd, name, flags | O_CLOEXEC);
+
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/%d/%s", handle->pid, name);
+	return open(path, flags | O_CLOEXEC);
+}
+
+ssize_t read_pid_file(const struct pid_handle *handle, const char *name, char *buf, const size_t size) {
+	int fd = open_pid_file(handle, name);
+	if (fd == -1)
+		return -1;
+
+	ssize_t len = read(fd, buf, size);
+	close(fd);
+	STAT_SYSCALLS(3);
+	if (len > 0)
+		STAT_BYTES_READ(len);
+	return len;
+}
+
+bool read_pid_file(const struct pid_handle *handle, const char *name, std::string *buf) {
+	int fd = open_pid_file(handle, name);
+	if (fd == -1)
+		return false;
+
+	buf->clear();
+	size_t used = 0;
+	ssize_t len = 0;
+	do {
+		used += len;
+		if (buf->size() < used + 4096)
+			buf->resize(used + 4096);
+		len = read(fd, &(*buf)[used], buf->size() - used);
+		STAT_SYSCALLS(1);
+	} while (len > 0);
+	close(fd);
+	STAT_SYSCALLS(2);
+	STAT_BYTES_READ(used);
+
+	buf->resize(used);
+	return len == 0;
+}
+
+PidHandleCache::PidHandleCache() {
+	// One fd per process adds up, take as many as the hard limit allows
+	struct rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+}
+
+PidHandleCache::~PidHandleCache() {
+	for (auto &entry : handles)
+		close_handle(&entry.second);
+}
+
+void PidHandleCache::close_handle(struct pid_handle *handle) {
+	if (handle->dirfd != -1)
+		close(handle->dirfd);
+	handle->dirfd = -1;
+}
+
+struct pid_handle *PidHandleCache::get(const int32_t pid) {
+	auto it = handles.find(pid);
+	if (it != handles.end()) {
+		// Opened while out of fds, try again now that there might be some
+		if (it->second.dirfd == -1 && !out_of_fds)
+			return reopen(pid);
+		return &it->second;
+	}
+
+	struct pid_handle &handle = handles[pid];
+	handle.pid = pid;
+	if (out_of_fds)
+		return &handle;
+
+	char path[32];
+	snprintf(path, sizeof(path), "/proc/%d", pid);
+	handle.dirfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	// Readers fall back to full paths for this one
+	if (handle.dirfd == -1 && (errno == EMFILE || errno == ENFILE))
+		out_of_fds = true;
+	return &handle;
+}
+
+const struct pid_handle *PidHandleCache::find(const int32_t pid) const {
+	auto it = handles.find(pid);
+	if (it == handles.end())
+		return nullptr;
+	return &it->second;
+}
+
+struct pid_handle *PidHandleCache::reopen(const int32_t pid) {
+	evict(pid);
+	return get(pid);
+}
+
+void PidHandleCache::evict(const int32_t pid) {
+	auto it = handles.find(pid);
+	if (it == handles.end())
+		return;
+
+	if (it->second.dirfd != -1)
+		out_of_fds = false;
+	close_handle(&it->second);
+	handles.erase(it);
+}
+
+void PidHandleCache::reconcile(const std::vector<struct pid_key> &current) {
+	reconciler.reconcile(previous, current, &result);
+
+	for (uint32_t i : result.removed) {
+		const struct pid_key &key = previous[i];
+		auto it = handles.find(key.pid);
+		// The pid may have been reused and its handle reopened for the new process
+		if (it != handles.end() && it->second.starttime == key.starttime)
+			evict(key.pid);
+	}
+
+	previous = current;
+}
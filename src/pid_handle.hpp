@@ -0,0 +1,71 @@
+#ifndef PID_HANDLE_HPP_
+#define PID_HANDLE_HPP_
+
+#include "reconcile.hpp"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+extern "C" {
+	#include <sys/types.h> // ssize_t
+	#include <fcntl.h> // O_RDONLY
+}
+
+// Where the io counters of a process come from. Picked once per process, so
+// its totals never switch between two different sums.
+enum io_source : uint8_t {
+	IO_UNDECIDED,
+	IO_TASKSTATS,
+	IO_PROCFS,
+};
+
+// Open handles on one process. The directory fd stays bound to the process it
+// was opened for, so a reused pid can't be read through it by mistake.
+struct pid_handle {
+	int32_t pid = 0;
+	// Start time of the process the handle was opened for, in clock ticks
+	uint64_t starttime = 0;
+	// O_DIRECTORY fd of /proc/{pid}, -1 falls back to path lookups
+	int dirfd = -1;
+	enum io_source io = IO_UNDECIDED;
+};
+
+// Open a file under /proc/{pid}, relative to the directory fd when there is one
+int open_pid_file(const struct pid_handle *handle, const char *name, const int flags = O_RDONLY);
+// Read up to size bytes of /proc/{pid}/{name} with a single read(), -1 on failure
+ssize_t read_pid_file(const struct pid_handle *handle, const char *name, char *buf, const size_t size);
+// Read all of /proc/{pid}/{name}, reusing buf's capacity
+bool read_pid_file(const struct pid_handle *handle, const char *name, std::string *buf);
+
+// Keeps a directory fd open for every live pid, so per-pid files are opened
+// with openat() instead of a full path walk on every read
+class PidHandleCache {
+public:
+	PidHandleCache();
+	~PidHandleCache();
+
+	// Cached handle of pid, opened if there is none yet
+	struct pid_handle *get(const int32_t pid);
+	// nullptr if pid has no handle
+	const struct pid_handle *find(const int32_t pid) const;
+	// Drop a cached handle and open a new one, for when the old process exited
+	struct pid_handle *reopen(const int32_t pid);
+	// Close the handle of pid
+	void evict(const int32_t pid);
+	// Close handles of processes that are missing from current
+	void reconcile(const std::vector<struct pid_key> &current);
+private:
+	void close_handle(struct pid_handle *handle);
+
+	std::unordered_map<int32_t, struct pid_handle> handles;
+	// Stop opening directory fds once the fd limit is hit, until some are closed
+	bool out_of_fds = false;
+
+	std::vector<struct pid_key> previous;
+	PidReconciler reconciler;
+	struct reconcile_result result;
+};
+
+#endif // PID_HANDLE_HPP_
@@ -1,25 +1,69 @@
 #include "proc.hpp"
+#include "parse.hpp"
+#include "field_dispatch.hpp"
+#include "stats.hpp"
 
 #include <iomanip>
 #include <cstring>
+#include <cstdio> // snprintf
 #include <chrono>
 #include <algorithm>
-#include <fstream>
+#include <iterator> // std::size
 
 extern "C" {
 	#include <errno.h> // errno
 	#include <stdlib.h> // strtol()
 	#include <dirent.h> // DIR, struct dirent, opendir()
+	#include <fcntl.h> // open()
+	#include <time.h> // clock_gettime()
+	#include <signal.h> // kill()
+	#include <sys/syscall.h> // SYS_pidfd_open
+	#include <sys/socket.h>
+	#include <linux/netlink.h>
+	#include <linux/genetlink.h>
+	#include <linux/taskstats.h>
 }
 
-void find_processes(std::vector<struct process> *processes) {
+ssize_t read_file(const char *path, char *buf, const size_t size) {
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return -1;
+
+	ssize_t len = read(fd, buf, size);
+	close(fd);
+	STAT_SYSCALLS(3);
+	if (len > 0)
+		STAT_BYTES_READ(len);
+	return len;
+}
+
+bool read_file(const char *path, std::string *buf) {
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return false;
+
+	buf->clear();
+	size_t used = 0;
+	ssize_t len = 0;
+	do {
+		used += len;
+		if (buf->size() < used + 4096)
+			buf->resize(used + 4096);
+		len = read(fd, &(*buf)[used], buf->size() - used);
+		STAT_SYSCALLS(1);
+	} while (len > 0);
+	close(fd);
+	STAT_SYSCALLS(2);
+	STAT_BYTES_READ(used);
+
+	buf->resize(used);
+	return len == 0;
+}
+
+void find_processes(std::vector<int32_t> *pids) {
 	DIR *proc_dir;
 	struct dirent *file;
 
-	/* Get list of processes from render node */
-	std::vector<uint64_t> pids;
-	pids.reserve(150);
-
 	proc_dir = opendir("/proc");
 	if(proc_dir == NULL) {
 		// perror("Unable to read directory proc");
@@ -37,753 +81,811 @@ void find_processes(std::vector<struct process> *processes) {
     	if ((pid = atoi(file->d_name)) == 0)
 			continue;
 
-		process p;
-		p.pid = pid;
-		get_process_name(pid, &p.name);
-		get_calling_command(pid, &p.cmd);
-		p.is_alive = true;
-		processes->push_back(p);
+		pids->push_back(pid);
 	}
 
 	closedir(proc_dir);
+	// opendir() and closedir(), the getdents() in between aren't seen
+	STAT_SYSCALLS(2);
 }
 
-void get_calling_command(const int32_t pid, std::string *cmd) {
-	std::string filepath(std::string("/proc/") + std::to_string(pid) + "/cmdline");
-    std::ifstream infile(filepath);
-    if (!infile.is_open())
-		return;
+ProcFile::ProcFile(const char *path) : path(path) {
+	buf.resize(4096);
+}
+
+ProcFile::~ProcFile() {
+	if (fd != -1)
+		close(fd);
+}
+
+bool ProcFile::read() {
+	len = 0;
+	if (fd == -1) {
+		fd = open(path, O_RDONLY | O_CLOEXEC);
+		STAT_SYSCALLS(1);
+	}
+	if (fd == -1)
+		return false;
+
+	ssize_t n;
+	while ((n = pread(fd, &buf[len], buf.size() - len, len)) > 0) {
+		STAT_SYSCALLS(1);
+		len += n;
+		// Filled up, there might be more
+		if (len == buf.size())
+			buf.resize(buf.size() * 2);
+	}
+	STAT_SYSCALLS(1);
+	if (n == -1) {
+		// Reopen on the next read in case the file went stale
+		close(fd);
+		fd = -1;
+		len = 0;
+		return false;
+	}
+	STAT_BYTES_READ(len);
+	return true;
+}
+
+ProcessSnapshot::ProcessSnapshot() : data(std::make_shared<struct snapshot_data>()) {
+	ticks_per_s = sysconf(_SC_CLK_TCK);
+}
+
+bool ProcessSnapshot::refresh(std::shared_ptr<const struct snapshot_data> latest) {
+	if (!latest || latest == data)
+		return false;
+	data = std::move(latest);
+	return true;
+}
+
+const struct process_sample *ProcessSnapshot::find(const uint64_t pid) const {
+	const std::vector<struct process_sample> &samples = data->processes;
+	auto it = std::lower_bound(samples.begin(), samples.end(), pid,
+		[](const struct process_sample &s, const uint64_t pid) {
+			return s.process.pid < pid;
+		});
+	if (it == samples.end() || it->process.pid != pid)
+		return nullptr;
+	return &(*it);
+}
+
+bool ProcessSnapshot::exec_seen(const uint64_t pid) const {
+	const std::vector<int32_t> &changed = data->changed;
+	return std::binary_search(changed.begin(), changed.end(), (int32_t)pid);
+}
+
+uint64_t ProcessSnapshot::get_pid_uptime(const struct process_sample *sample) const {
+	// Start time in seconds since boot
+	uint64_t starttime = sample->stat.starttime / ticks_per_s;
+	if (starttime > data->uptime)
+		return 0;
+	return data->uptime - starttime;
+}
 
-    infile >> *cmd;
+int ProcessSnapshot::send_signal(const uint64_t pid, const int sig) const {
+#if defined(SYS_pidfd_open) && defined(SYS_pidfd_send_signal)
+	const struct process_sample *sample = find(pid);
+	if (sample) {
+		int pidfd = syscall(SYS_pidfd_open, pid, 0);
+		if (pidfd == -1 && errno != ENOSYS)
+			return -1;
+		if (pidfd != -1) {
+			// The pidfd is bound to whichever process has the pid now, it's the one
+			// in the snapshot if its start time still matches after pidfd_open
+			struct pid_handle handle;
+			handle.pid = pid;
+			struct pid_stat stat;
+			if (!read_pid_stat(&handle, &stat) || stat.starttime != sample->process.starttime) {
+				close(pidfd);
+				errno = ESRCH;
+				return -1;
+			}
+			int ret = syscall(SYS_pidfd_send_signal, pidfd, sig, nullptr, 0);
+			int err = errno;
+			close(pidfd);
+			if (ret == 0 || err != ENOSYS) {
+				errno = err;
+				return ret;
+			}
+		}
+	}
+#endif
+	return kill(pid, sig);
 }
 
-void get_process_name(const int32_t pid, std::string *name) {
-	std::string filepath(std::string("/proc/") + std::to_string(pid) + "/comm");
-    std::ifstream infile(filepath);
-    if (!infile.is_open())
+void get_calling_command(const struct pid_handle *handle, std::string *cmd, const size_t max_len) {
+	cmd->clear();
+	int fd = open_pid_file(handle, "cmdline");
+	if (fd == -1)
 		return;
 
-    infile >> *name;
+	// One read is enough, procfs hands out as much of argv as fits
+	cmd->resize(max_len);
+	ssize_t len = read(fd, &(*cmd)[0], max_len);
+	close(fd);
+	STAT_SYSCALLS(3);
+	if (len <= 0) {
+		cmd->clear();
+		return;
+	}
+	cmd->resize(len);
+	STAT_BYTES_READ(len);
+
+	// Arguments are NUL separated, and NUL terminated unless cut off
+	while (!cmd->empty() && cmd->back() == '\0')
+		cmd->pop_back();
+	for (char &c : *cmd)
+		if (c == '\0' || c == '\n')
+			c = ' ';
 }
 
+static constexpr field<struct cpuinfo_core> cpuinfo_fields[] = {
+	FIELD(cpuinfo_core, processor, "processor"),
+	FIELD(cpuinfo_core, vendor_id, "vendor_id"),
+	FIELD(cpuinfo_core, cpu_family, "cpu family"),
+	FIELD(cpuinfo_core, model, "model"),
+	FIELD(cpuinfo_core, model_name, "model name"),
+	FIELD(cpuinfo_core, stepping, "stepping"),
+	FIELD(cpuinfo_core, microcode, "microcode"),
+	FIELD(cpuinfo_core, cpu_MHz, "cpu MHz"),
+	FIELD(cpuinfo_core, cache_size, "cache size"),
+	FIELD(cpuinfo_core, physical_id, "physical id"),
+	FIELD(cpuinfo_core, siblings, "siblings"),
+	FIELD(cpuinfo_core, core_id, "core id"),
+	FIELD(cpuinfo_core, cpu_cores, "cpu cores"),
+	FIELD(cpuinfo_core, apicid, "apicid"),
+	FIELD(cpuinfo_core, initial_apicid, "initial apicid"),
+	FIELD(cpuinfo_core, fpu, "fpu"),
+	FIELD(cpuinfo_core, fpu_exception, "fpu_exception"),
+	FIELD(cpuinfo_core, cpuid_level, "cpuid level"),
+	FIELD(cpuinfo_core, wp, "wp"),
+	FIELD(cpuinfo_core, flags, "flags"),
+	FIELD(cpuinfo_core, bugs, "bugs"),
+	FIELD(cpuinfo_core, bogomips, "bogomips"),
+	FIELD(cpuinfo_core, clflush_size, "clflush size"),
+	FIELD(cpuinfo_core, cache_alignment, "cache_alignment"),
+	FIELD(cpuinfo_core, address_sizes, "address sizes"),
+	FIELD(cpuinfo_core, power_management, "power management"),
+};
+static constexpr FieldTable<struct cpuinfo_core, std::size(cpuinfo_fields)> cpuinfo_table(cpuinfo_fields);
+static_assert(cpuinfo_table.valid(), "No perfect hash for cpuinfo keys");
+
 void read_cpuinfo(std::vector<struct cpuinfo_core> *info) {
-	std::string filepath("/proc/cpuinfo");
-    std::ifstream infile(filepath);
-    if (!infile.is_open())
+	STAT_TIMER(PHASE_SYS);
+	// Grows with the number of cores, so it's read whole
+	std::string buf;
+	if (!read_file("/proc/cpuinfo", &buf))
 		return;
 
-	const std::string processor__str = "processor";
-	const std::string vendor_id__str = "vendor_id";
-	const std::string cpu_family__str = "cpu family";
-	const std::string model__str = "model";
-	const std::string model_name__str = "model name";
-	const std::string stepping__str = "stepping";
-	const std::string microcode__str = "microcode";
-	const std::string cpu_MHz__str = "cpu MHz";
-	const std::string cache_size__str = "cache size";
-	const std::string physical_id__str = "physical id";
-	const std::string siblings__str = "siblings";
-	const std::string core_id__str = "core id";
-	const std::string cpu_cores__str = "cpu cores";
-	const std::string apicid__str = "apicid";
-	const std::string initial_apicid__str = "initial apicid";
-	const std::string fpu__str = "fpu";
-	const std::string fpu_exception__str = "fpu_exception";
-	const std::string cpuid_level__str = "cpuid level";
-	const std::string wp__str = "wp";
-	const std::string flags__str = "flags";
-	const std::string bugs__str = "bugs";
-	const std::string bogomips__str = "bogomips";
-	const std::string clflush_size__str = "clflush size";
-	const std::string cache_alignment__str = "cache_alignment";
-	const std::string address_sizes__str = "address sizes";
-	const std::string power_management__str = "power management";
-
-    struct cpuinfo_core core;
-
-    std::string line;
-    std::string type;
-    std::string value;
-    int delim_pos;
-    while (std::getline(infile, line)) {
-        if (line.empty()) {
-			info->push_back(core);
-            continue;
-		}
-        delim_pos = line.find_first_of(":\t");
-        type = line.substr(0, delim_pos);
-        delim_pos = line.find_first_of(":");
-        line = line.substr(delim_pos+1);
-        if (line.empty())
-			value = "";
-		else {
-			// Offset by 1 for the space after :
-			value = line.substr(1);
-		}
+	struct cpuinfo_core core;
 
-        if (type == processor__str) {
-			core.processor = std::stoul(value);
-		} else if (type == vendor_id__str) {
-			core.vendor_id = value;
-		} else if (type == cpu_family__str) {
-			core.cpu_family = std::stoul(value);
-		} else if (type == model__str) {
-			core.model = std::stoul(value);
-		} else if (type == model_name__str) {
-			core.model_name = value;
-		} else if (type == stepping__str) {
-			core.stepping = std::stoul(value);
-		} else if (type == microcode__str) {
-			core.microcode = value;
-		} else if (type == cpu_MHz__str) {
-			core.cpu_MHz = std::stof(value);
-		} else if (type == cache_size__str) {
-			core.cache_size = value;
-		} else if (type == physical_id__str) {
-			core.physical_id = std::stoul(value);
-		} else if (type == siblings__str) {
-			core.siblings = std::stoul(value);
-		} else if (type == core_id__str) {
-			core.core_id = std::stoul(value);
-		} else if (type == cpu_cores__str) {
-			core.cpu_cores = std::stoul(value);
-		} else if (type == apicid__str) {
-			core.apicid = std::stoul(value);
-		} else if (type == initial_apicid__str) {
-			core.initial_apicid = std::stoul(value);
-		} else if (type == fpu__str) {
-			core.fpu = value;
-		} else if (type == fpu_exception__str) {
-			core.fpu_exception = value;
-		} else if (type == cpuid_level__str) {
-			core.cpuid_level = std::stoul(value);
-		} else if (type == wp__str) {
-			core.wp = value;
-		} else if (type == flags__str) {
-			core.flags = value;
-		} else if (type == bugs__str) {
-			core.bugs = value;
-		} else if (type == bogomips__str) {
-			core.bogomips = std::stof(value);
-		} else if (type == clflush_size__str) {
-			core.clflush_size = std::stoul(value);
-		} else if (type == cache_alignment__str) {
-			core.cache_alignment = std::stoul(value);
-		} else if (type == address_sizes__str) {
-			core.address_sizes = value;
-		} else if (type == power_management__str) {
-			core.power_management = value;
+	const char *cur = buf.data();
+	const char *end = buf.data() + buf.size();
+	std::string_view line;
+	while (next_line(cur, end, &line)) {
+		// Cores are separated by an empty line
+		if (line.empty()) {
+			info->push_back(core);
+			continue;
 		}
+		dispatch_line(cpuinfo_table, &core, line, ":\t");
 	}
 }
 
+static constexpr field<struct meminfo> meminfo_fields[] = {
+	FIELD(meminfo, MemTotal, "MemTotal"),
+	FIELD(meminfo, MemFree, "MemFree"),
+	FIELD(meminfo, MemAvailable, "MemAvailable"),
+	FIELD(meminfo, Buffers, "Buffers"),
+	FIELD(meminfo, Cached, "Cached"),
+	FIELD(meminfo, SwapCached, "SwapCached"),
+	FIELD(meminfo, Active, "Active"),
+	FIELD(meminfo, Inactive, "Inactive"),
+	FIELD(meminfo, Active_anon, "Active(anon)"),
+	FIELD(meminfo, Inactive_anon, "Inactive(anon)"),
+	FIELD(meminfo, Active_file, "Active(file)"),
+	FIELD(meminfo, Inactive_file, "Inactive(file)"),
+	FIELD(meminfo, Unevictable, "Unevictable"),
+	FIELD(meminfo, Mlocked, "Mlocked"),
+	FIELD(meminfo, SwapTotal, "SwapTotal"),
+	FIELD(meminfo, SwapFree, "SwapFree"),
+	FIELD(meminfo, Zswap, "Zswap"),
+	FIELD(meminfo, Zswapped, "Zswapped"),
+	FIELD(meminfo, Dirty, "Dirty"),
+	FIELD(meminfo, Writeback, "Writeback"),
+	FIELD(meminfo, AnonPages, "AnonPages"),
+	FIELD(meminfo, Mapped, "Mapped"),
+	FIELD(meminfo, Shmem, "Shmem"),
+	FIELD(meminfo, KReclaimable, "KReclaimable"),
+	FIELD(meminfo, Slab, "Slab"),
+	FIELD(meminfo, SReclaimable, "SReclaimable"),
+	FIELD(meminfo, SUnreclaim, "SUnreclaim"),
+	FIELD(meminfo, KernelStack, "KernelStack"),
+	FIELD(meminfo, PageTables, "PageTables"),
+	FIELD(meminfo, NFS_Unstable, "NFS_Unstable"),
+	FIELD(meminfo, Bounce, "Bounce"),
+	FIELD(meminfo, WritebackTmp, "WritebackTmp"),
+	FIELD(meminfo, CommitLimit, "CommitLimit"),
+	FIELD(meminfo, Committed_AS, "Committed_AS"),
+	FIELD(meminfo, VmallocTotal, "VmallocTotal"),
+	FIELD(meminfo, VmallocUsed, "VmallocUsed"),
+	FIELD(meminfo, VmallocChunk, "VmallocChunk"),
+	FIELD(meminfo, Percpu, "Percpu"),
+	FIELD(meminfo, HardwareCorrupted, "HardwareCorrupted"),
+	FIELD(meminfo, AnonHugePages, "AnonHugePages"),
+	FIELD(meminfo, ShmemHugePages, "ShmemHugePages"),
+	FIELD(meminfo, ShmemPmdMapped, "ShmemPmdMapped"),
+	FIELD(meminfo, FileHugePages, "FileHugePages"),
+	FIELD(meminfo, FilePmdMapped, "FilePmdMapped"),
+	FIELD(meminfo, HugePages_Total, "HugePages_Total"),
+	FIELD(meminfo, HugePages_Free, "HugePages_Free"),
+	FIELD(meminfo, HugePages_Rsvd, "HugePages_Rsvd"),
+	FIELD(meminfo, HugePages_Surp, "HugePages_Surp"),
+	FIELD(meminfo, Hugepagesize, "Hugepagesize"),
+	FIELD(meminfo, Hugetlb, "Hugetlb"),
+	FIELD(meminfo, DirectMap4k, "DirectMap4k"),
+	FIELD(meminfo, DirectMap2M, "DirectMap2M"),
+	FIELD(meminfo, DirectMap1G, "DirectMap1G"),
+};
+static constexpr FieldTable<struct meminfo, std::size(meminfo_fields)> meminfo_table(meminfo_fields);
+static_assert(meminfo_table.valid(), "No perfect hash for meminfo keys");
+
 void read_meminfo(struct meminfo *info) {
-	std::string filepath("/proc/meminfo");
-    std::ifstream infile(filepath);
-    if (!infile.is_open())
+	STAT_TIMER(PHASE_SYS);
+	static ProcFile file("/proc/meminfo");
+	if (!file.read())
 		return;
 
-	const std::string MemTotal__str = "MemTotal";
-	const std::string MemFree__str = "MemFree";
-	const std::string MemAvailable__str = "MemAvailable";
-	const std::string Buffers__str = "Buffers";
-	const std::string Cached__str = "Cached";
-	const std::string SwapCached__str = "SwapCached";
-	const std::string Active__str = "Active";
-	const std::string Inactive__str = "Inactive";
-	const std::string Active_anon__str = "Active(anon)";
-	const std::string Inactive_anon__str = "Inactive(anon)";
-	const std::string Active_file__str = "Active(file)";
-	const std::string Inactive_file__str = "Inactive(file)";
-	const std::string Unevictable__str = "Unevictable";
-	const std::string Mlocked__str = "Mlocked";
-	const std::string SwapTotal__str = "SwapTotal";
-	const std::string SwapFree__str = "SwapFree";
-	const std::string Zswap__str = "Zswap";
-	const std::string Zswapped__str = "Zswapped";
-	const std::string Dirty__str = "Dirty";
-	const std::string Writeback__str = "Writeback";
-	const std::string AnonPages__str = "AnonPages";
-	const std::string Mapped__str = "Mapped";
-	const std::string Shmem__str = "Shmem";
-	const std::string KReclaimable__str = "KReclaimable";
-	const std::string Slab__str = "Slab";
-	const std::string SReclaimable__str = "SReclaimable";
-	const std::string SUnreclaim__str = "SUnreclaim";
-	const std::string KernelStack__str = "KernelStack";
-	const std::string PageTables__str = "PageTables";
-	const std::string NFS_Unstable__str = "NFS_Unstable";
-	const std::string Bounce__str = "Bounce";
-	const std::string WritebackTmp__str = "WritebackTmp";
-	const std::string CommitLimit__str = "CommitLimit";
-	const std::string Committed_AS__str = "Committed_AS";
-	const std::string VmallocTotal__str = "VmallocTotal";
-	const std::string VmallocUsed__str = "VmallocUsed";
-	const std::string VmallocChunk__str = "VmallocChunk";
-	const std::string Percpu__str = "Percpu";
-	const std::string HardwareCorrupted__str = "HardwareCorrupted";
-	const std::string AnonHugePages__str = "AnonHugePages";
-	const std::string ShmemHugePages__str = "ShmemHugePages";
-	const std::string ShmemPmdMapped__str = "ShmemPmdMapped";
-	const std::string FileHugePages__str = "FileHugePages";
-	const std::string FilePmdMapped__str = "FilePmdMapped";
-	const std::string HugePages_Total__str = "HugePages_Total";
-	const std::string HugePages_Free__str = "HugePages_Free";
-	const std::string HugePages_Rsvd__str = "HugePages_Rsvd";
-	const std::string HugePages_Surp__str = "HugePages_Surp";
-	const std::string Hugepagesize__str = "Hugepagesize";
-	const std::string Hugetlb__str = "Hugetlb";
-	const std::string DirectMap4k__str = "DirectMap4k";
-	const std::string DirectMap2M__str = "DirectMap2M";
-	const std::string DirectMap1G__str = "DirectMap1G";
-
-    std::string line;
-    std::string type;
-    std::string value;
-    int delim_pos;
-    while (std::getline(infile, line)) {
-        delim_pos = line.find_first_of(":\t");
-        type = line.substr(0, delim_pos);
-        line = line.substr(delim_pos+1);
-        delim_pos = line.find_last_of(" ");
-		// Remove kB for values that print it
-		if (!isdigit(line.at(delim_pos+1))) {
-			line = line.substr(0, delim_pos);
-        	delim_pos = line.find_last_of(" ");
-		}
-        value = line.substr(delim_pos+1);
-
-		if (type == MemTotal__str) {
-			info->MemTotal = std::stoul(value);
-		} else if (type == MemFree__str) {
-			info->MemFree = std::stoul(value);
-		} else if (type == MemAvailable__str) {
-			info->MemAvailable = std::stoul(value);
-		} else if (type == Buffers__str) {
-			info->Buffers = std::stoul(value);
-		} else if (type == Cached__str) {
-			info->Cached = std::stoul(value);
-		} else if (type == SwapCached__str) {
-			info->SwapCached = std::stoul(value);
-		} else if (type == Active__str) {
-			info->Active = std::stoul(value);
-		} else if (type == Inactive__str) {
-			info->Inactive = std::stoul(value);
-		} else if (type == Active_anon__str) {
-			info->Active_anon = std::stoul(value);
-		} else if (type == Inactive_anon__str) {
-			info->Inactive_anon = std::stoul(value);
-		} else if (type == Active_file__str) {
-			info->Active_file = std::stoul(value);
-		} else if (type == Inactive_file__str) {
-			info->Inactive_file = std::stoul(value);
-		} else if (type == Unevictable__str) {
-			info->Unevictable = std::stoul(value);
-		} else if (type == Mlocked__str) {
-			info->Mlocked = std::stoul(value);
-		} else if (type == SwapTotal__str) {
-			info->SwapTotal = std::stoul(value);
-		} else if (type == SwapFree__str) {
-			info->SwapFree = std::stoul(value);
-		} else if (type == Zswap__str) {
-			info->Zswap = std::stoul(value);
-		} else if (type == Zswapped__str) {
-			info->Zswapped = std::stoul(value);
-		} else if (type == Dirty__str) {
-			info->Dirty = std::stoul(value);
-		} else if (type == Writeback__str) {
-			info->Writeback = std::stoul(value);
-		} else if (type == AnonPages__str) {
-			info->AnonPages = std::stoul(value);
-		} else if (type == Mapped__str) {
-			info->Mapped = std::stoul(value);
-		} else if (type == Shmem__str) {
-			info->Shmem = std::stoul(value);
-		} else if (type == KReclaimable__str) {
-			info->KReclaimable = std::stoul(value);
-		} else if (type == Slab__str) {
-			info->Slab = std::stoul(value);
-		} else if (type == SReclaimable__str) {
-			info->SReclaimable = std::stoul(value);
-		} else if (type == SUnreclaim__str) {
-			info->SUnreclaim = std::stoul(value);
-		} else if (type == KernelStack__str) {
-			info->KernelStack = std::stoul(value);
-		} else if (type == PageTables__str) {
-			info->PageTables = std::stoul(value);
-		} else if (type == NFS_Unstable__str) {
-			info->NFS_Unstable = std::stoul(value);
-		} else if (type == Bounce__str) {
-			info->Bounce = std::stoul(value);
-		} else if (type == WritebackTmp__str) {
-			info->WritebackTmp = std::stoul(value);
-		} else if (type == CommitLimit__str) {
-			info->CommitLimit = std::stoul(value);
-		} else if (type == Committed_AS__str) {
-			info->Committed_AS = std::stoul(value);
-		} else if (type == VmallocTotal__str) {
-			info->VmallocTotal = std::stoul(value);
-		} else if (type == VmallocUsed__str) {
-			info->VmallocUsed = std::stoul(value);
-		} else if (type == VmallocChunk__str) {
-			info->VmallocChunk = std::stoul(value);
-		} else if (type == Percpu__str) {
-			info->Percpu = std::stoul(value);
-		} else if (type == HardwareCorrupted__str) {
-			info->HardwareCorrupted = std::stoul(value);
-		} else if (type == AnonHugePages__str) {
-			info->AnonHugePages = std::stoul(value);
-		} else if (type == ShmemHugePages__str) {
-			info->ShmemHugePages = std::stoul(value);
-		} else if (type == ShmemPmdMapped__str) {
-			info->ShmemPmdMapped = std::stoul(value);
-		} else if (type == FileHugePages__str) {
-			info->FileHugePages = std::stoul(value);
-		} else if (type == FilePmdMapped__str) {
-			info->FilePmdMapped = std::stoul(value);
-		} else if (type == HugePages_Total__str) {
-			info->HugePages_Total = std::stoul(value);
-		} else if (type == HugePages_Free__str) {
-			info->HugePages_Free = std::stoul(value);
-		} else if (type == HugePages_Rsvd__str) {
-			info->HugePages_Rsvd = std::stoul(value);
-		} else if (type == HugePages_Surp__str) {
-			info->HugePages_Surp = std::stoul(value);
-		} else if (type == Hugepagesize__str) {
-			info->Hugepagesize = std::stoul(value);
-		} else if (type == Hugetlb__str) {
-			info->Hugetlb = std::stoul(value);
-		} else if (type == DirectMap4k__str) {
-			info->DirectMap4k = std::stoul(value);
-		} else if (type == DirectMap2M__str) {
-			info->DirectMap2M = std::stoul(value);
-		} else if (type == DirectMap1G__str) {
-			info->DirectMap1G = std::stoul(value);
-		}
-	}
+	std::string_view contents = file.contents();
+	const char *cur = contents.data();
+	std::string_view line;
+	while (next_line(cur, contents.data() + contents.size(), &line))
+		dispatch_line(meminfo_table, info, line, ":\t");
 }
 
 void read_cpu_stat(struct cpu_stat *stats) {
-	std::string filepath("/proc/stat");
-    std::ifstream infile(filepath);
-    if (!infile.is_open())
+	STAT_TIMER(PHASE_SYS);
+	static ProcFile file("/proc/stat");
+	if (!file.read())
 		return;
 
-    std::string cpu;
+	std::string_view contents = file.contents();
+	const char *cur = contents.data();
+	const char *end = contents.data() + contents.size();
+	// Skip the "cpu" label of the aggregate line
+	cur = static_cast<const char *>(memchr(cur, ' ', end - cur));
+	if (!cur)
+		return;
 
-    infile >> cpu
-		>> stats->user
-		>> stats->nice
-		>> stats->system
-		>> stats->idle
-		>> stats->iowait
-		>> stats->irq
-		>> stats->softirq
-		>> stats->steal
-		>> stats->guest
-		>> stats->guest_nice;
+	scan_int(cur, end, &stats->user)
+		&& scan_int(cur, end, &stats->nice)
+		&& scan_int(cur, end, &stats->system)
+		&& scan_int(cur, end, &stats->idle)
+		&& scan_int(cur, end, &stats->iowait)
+		&& scan_int(cur, end, &stats->irq)
+		&& scan_int(cur, end, &stats->softirq)
+		&& scan_int(cur, end, &stats->steal)
+		&& scan_int(cur, end, &stats->guest)
+		&& scan_int(cur, end, &stats->guest_nice);
 }
 
-void read_net_dev(std::vector<struct net_interface> *net_vec) {
-	std::string filepath(std::string("/proc/net/dev"));
-    std::ifstream infile(filepath);
-    if (!infile.is_open())
+void read_cpu_core_stats(struct cpu_core_stats *stats) {
+	STAT_TIMER(PHASE_SYS);
+	static ProcFile file("/proc/stat");
+	if (!file.read())
 		return;
 
-    std::string line;
+	std::string_view contents = file.contents();
+	const char *cur = contents.data();
+	const char *end = contents.data() + contents.size();
+	std::string_view line;
+	// Skip the aggregate line
+	next_line(cur, end, &line);
+
+	size_t n = 0;
+	uint64_t guest;
+	uint64_t guest_nice;
+	while (next_line(cur, end, &line)) {
+		// The cpuN lines come first, stop at whatever follows them
+		if (line.size() < 4 || line.compare(0, 3, "cpu") != 0)
+			break;
+		if (n >= stats->size())
+			stats->resize(n + 1);
+
+		const char *field = line.data() + 3;
+		const char *line_end = line.data() + line.size();
+		guest = 0;
+		guest_nice = 0;
+		scan_int(field, line_end, &stats->id[n])
+			&& scan_int(field, line_end, &stats->user[n])
+			&& scan_int(field, line_end, &stats->nice[n])
+			&& scan_int(field, line_end, &stats->system[n])
+			&& scan_int(field, line_end, &stats->idle[n])
+			&& scan_int(field, line_end, &stats->iowait[n])
+			&& scan_int(field, line_end, &stats->irq[n])
+			&& scan_int(field, line_end, &stats->softirq[n])
+			&& scan_int(field, line_end, &stats->steal[n])
+			&& scan_int(field, line_end, &guest)
+			&& scan_int(field, line_end, &guest_nice);
+		n++;
+	}
+	stats->resize(n);
+}
+
+void cpu_core_delta(const struct cpu_core_stats &previous, const struct cpu_core_stats &current,
+					struct cpu_core_usage *usage) {
+	const size_t n = current.size();
+	usage->user.resize(n);
+	usage->system.resize(n);
+	usage->iowait.resize(n);
+	usage->steal.resize(n);
+
+	// Cores went on or offline, the arrays don't line up anymore
+	if (previous.size() != n || previous.id != current.id) {
+		std::fill(usage->user.begin(), usage->user.end(), 0);
+		std::fill(usage->system.begin(), usage->system.end(), 0);
+		std::fill(usage->iowait.begin(), usage->iowait.end(), 0);
+		std::fill(usage->steal.begin(), usage->steal.end(), 0);
+		return;
+	}
+
+	// No branches or aliasing in here, so the compiler can vectorise it
+	const uint64_t *__restrict p_user = previous.user.data();
+	const uint64_t *__restrict p_nice = previous.nice.data();
+	const uint64_t *__restrict p_system = previous.system.data();
+	const uint64_t *__restrict p_idle = previous.idle.data();
+	const uint64_t *__restrict p_iowait = previous.iowait.data();
+	const uint64_t *__restrict p_irq = previous.irq.data();
+	const uint64_t *__restrict p_softirq = previous.softirq.data();
+	const uint64_t *__restrict p_steal = previous.steal.data();
+	const uint64_t *__restrict c_user = current.user.data();
+	const uint64_t *__restrict c_nice = current.nice.data();
+	const uint64_t *__restrict c_system = current.system.data();
+	const uint64_t *__restrict c_idle = current.idle.data();
+	const uint64_t *__restrict c_iowait = current.iowait.data();
+	const uint64_t *__restrict c_irq = current.irq.data();
+	const uint64_t *__restrict c_softirq = current.softirq.data();
+	const uint64_t *__restrict c_steal = current.steal.data();
+	float *__restrict o_user = usage->user.data();
+	float *__restrict o_system = usage->system.data();
+	float *__restrict o_iowait = usage->iowait.data();
+	float *__restrict o_steal = usage->steal.data();
+
+	// Counters that went backwards, like per-core iowait does, count as 0.
+	// A select rather than a branch, it vectorises all the same.
+	auto delta = [](const uint64_t now, const uint64_t before) {
+		return now > before ? now - before : 0;
+	};
+	for (size_t i = 0; i < n; i++) {
+		float user = delta(c_user[i], p_user[i]) + delta(c_nice[i], p_nice[i]);
+		float system = delta(c_system[i], p_system[i]) + delta(c_irq[i], p_irq[i])
+			+ delta(c_softirq[i], p_softirq[i]);
+		float idle = delta(c_idle[i], p_idle[i]);
+		float iowait = delta(c_iowait[i], p_iowait[i]);
+		float steal = delta(c_steal[i], p_steal[i]);
+		// Guest time is part of user already
+		float total = user + system + idle + iowait + steal;
+		float scale = 1.0f / std::max(total, 1.0f);
+		o_user[i] = user * scale;
+		o_system[i] = system * scale;
+		o_iowait[i] = iowait * scale;
+		o_steal[i] = steal * scale;
+	}
+}
+
+// Parse the contents of /proc/net/dev or /proc/{pid}/net/dev
+static void parse_net_dev(std::string_view contents, std::vector<struct net_interface> *net_vec) {
+	const char *cur = contents.data();
+	const char *end = contents.data() + contents.size();
+	std::string_view line;
 	// Skip the header lines
-    std::getline(infile, line);
-    std::getline(infile, line);
+	next_line(cur, end, &line);
+	next_line(cur, end, &line);
 
 	struct net_interface net;
-	while (infile) {
-		net = {};
-		infile >> net.interface;
-		if (net.interface == "")
+	while (next_line(cur, end, &line)) {
+		size_t colon = line.find(':');
+		if (colon == std::string_view::npos)
 			continue;
-		// Remove : from interface name
-		net.interface = net.interface.substr(0, net.interface.size()-1);
-		infile >> net.rx_bytes
-			>> net.rx_packets
-			>> net.rx_errs
-			>> net.rx_drop
-			>> net.rx_fifo
-			>> net.rx_frame
-			>> net.rx_compressed
-			>> net.rx_multicast
-			>> net.tx_bytes
-			>> net.tx_packets
-			>> net.tx_errs
-			>> net.tx_drop
-			>> net.tx_fifo
-			>> net.tx_colls
-			>> net.tx_carrier
-			>> net.tx_compressed;
+		size_t name_start = line.find_first_not_of(' ');
+
+		net = {};
+		net.interface = line.substr(name_start, colon - name_start);
+
+		const char *field = line.data() + colon + 1;
+		const char *line_end = line.data() + line.size();
+		uint64_t multicast = 0;
+		scan_int(field, line_end, &net.rx_bytes)
+			&& scan_int(field, line_end, &net.rx_packets)
+			&& scan_int(field, line_end, &net.rx_errs)
+			&& scan_int(field, line_end, &net.rx_drop)
+			&& scan_int(field, line_end, &net.rx_fifo)
+			&& scan_int(field, line_end, &net.rx_frame)
+			&& scan_int(field, line_end, &net.rx_compressed)
+			&& scan_int(field, line_end, &multicast)
+			&& scan_int(field, line_end, &net.tx_bytes)
+			&& scan_int(field, line_end, &net.tx_packets)
+			&& scan_int(field, line_end, &net.tx_errs)
+			&& scan_int(field, line_end, &net.tx_drop)
+			&& scan_int(field, line_end, &net.tx_fifo)
+			&& scan_int(field, line_end, &net.tx_colls)
+			&& scan_int(field, line_end, &net.tx_carrier)
+			&& scan_int(field, line_end, &net.tx_compressed);
+		net.rx_multicast = std::to_string(multicast);
 		net_vec->push_back(net);
 	}
 }
 
-void read_pid_io(int32_t pid, struct pid_io *io) {
-	std::string filepath(std::string("/proc/") + std::to_string(pid) + "/io");
-    std::ifstream infile(filepath);
-    if (!infile.is_open())
+void read_net_dev(std::vector<struct net_interface> *net_vec) {
+	STAT_TIMER(PHASE_SYS);
+	static ProcFile file("/proc/net/dev");
+	if (!file.read())
 		return;
 
-	const std::string rchar__str = "rchar";
-	const std::string wchar__str = "wchar";
-	const std::string syscr__str = "syscr";
-	const std::string syscw__str = "syscw";
-	const std::string read_bytes__str = "read_bytes";
-	const std::string write_bytes__str = "write_bytes";
-	const std::string cancelled_write_bytes__str = "cancelled_write_bytes";
-
-    std::string line;
-    std::string type;
-    std::string value;
-    int delim_pos;
-    while (std::getline(infile, line)) {
-        delim_pos = line.find_first_of(":");
-        type = line.substr(0, delim_pos);
-        // Account for space after:
-        value = line.substr(delim_pos+2);
-
-		if (type == rchar__str) {
-			io->rchar= std::stoul(value);
-		} else if (type == wchar__str) {
-			io->wchar= std::stoul(value);
-		} else if (type == syscr__str) {
-			io->syscr= std::stoul(value);
-		} else if (type == syscw__str) {
-			io->syscw= std::stoul(value);
-		} else if (type == read_bytes__str) {
-			io->read_bytes= std::stoul(value);
-		} else if (type == write_bytes__str) {
-			io->write_bytes= std::stoul(value);
-		} else if (type == cancelled_write_bytes__str) {
-			io->cancelled_write_bytes= std::stoul(value);
-		}
-	}
+	parse_net_dev(file.contents(), net_vec);
 }
 
-void read_pid_net(const int32_t pid, std::vector<struct net_interface> *net_vec) {
-	std::string filepath(std::string("/proc/") + std::to_string(pid) + "/net/dev");
-    std::ifstream infile(filepath);
-    if (!infile.is_open())
+static constexpr field<struct pid_io> pid_io_fields[] = {
+	FIELD(pid_io, rchar, "rchar"),
+	FIELD(pid_io, wchar, "wchar"),
+	FIELD(pid_io, syscr, "syscr"),
+	FIELD(pid_io, syscw, "syscw"),
+	FIELD(pid_io, read_bytes, "read_bytes"),
+	FIELD(pid_io, write_bytes, "write_bytes"),
+	FIELD(pid_io, cancelled_write_bytes, "cancelled_write_bytes"),
+};
+static constexpr FieldTable<struct pid_io, std::size(pid_io_fields)> pid_io_table(pid_io_fields);
+static_assert(pid_io_table.valid(), "No perfect hash for pid_io keys");
+
+void read_pid_io(const struct pid_handle *handle, struct pid_io *io) {
+	char buf[512];
+	ssize_t len = read_pid_file(handle, "io", buf, sizeof(buf));
+	if (len <= 0)
 		return;
 
-    std::string line;
-	// Skip the header lines
-    std::getline(infile, line);
-    std::getline(infile, line);
+	const char *cur = buf;
+	std::string_view line;
+	while (next_line(cur, buf + len, &line))
+		dispatch_line(pid_io_table, io, line, ":");
+}
 
-	struct net_interface net;
-	while (infile) {
-		net = {};
-		infile >> net.interface;
-		if (net.interface == "")
-			continue;
-		// Remove : from interface name
-		net.interface = net.interface.substr(0, net.interface.size()-1);
-		infile >> net.rx_bytes
-			>> net.rx_packets
-			>> net.rx_errs
-			>> net.rx_drop
-			>> net.rx_fifo
-			>> net.rx_frame
-			>> net.rx_compressed
-			>> net.rx_multicast
-			>> net.tx_bytes
-			>> net.tx_packets
-			>> net.tx_errs
-			>> net.tx_drop
-			>> net.tx_fifo
-			>> net.tx_colls
-			>> net.tx_carrier
-			>> net.tx_compressed;
-		net_vec->push_back(net);
+void read_thread_io(struct pid_io *io) {
+	char buf[512];
+	ssize_t len = read_file("/proc/thread-self/io", buf, sizeof(buf));
+	if (len <= 0)
+		return;
+
+	const char *cur = buf;
+	std::string_view line;
+	while (next_line(cur, buf + len, &line))
+		dispatch_line(pid_io_table, io, line, ":");
+}
+
+// Generic netlink request with a single attribute
+struct genl_request {
+	struct nlmsghdr header;
+	struct genlmsghdr genl;
+	char attrs[64];
+};
+
+static bool send_genl(const int sock, const uint16_t family, const uint8_t cmd,
+					  const uint16_t attr, const void *data, const uint16_t len) {
+	struct genl_request request;
+	memset(&request, 0, sizeof(request));
+	request.header.nlmsg_type = family;
+	request.header.nlmsg_flags = NLM_F_REQUEST;
+	request.genl.cmd = cmd;
+	request.genl.version = 1;
+
+	struct nlattr *nla = (struct nlattr *)request.attrs;
+	nla->nla_type = attr;
+	nla->nla_len = NLA_HDRLEN + len;
+	memcpy(request.attrs + NLA_HDRLEN, data, len);
+	request.header.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN) + NLA_ALIGN(nla->nla_len);
+
+	return send(sock, &request, request.header.nlmsg_len, 0) != -1;
+}
+
+// Attribute of the given type in [cur, cur + len), nullptr if there is none
+static const struct nlattr *find_attr(const char *cur, int len, const uint16_t type) {
+	while (len >= NLA_HDRLEN) {
+		const struct nlattr *nla = (const struct nlattr *)cur;
+		if (nla->nla_len < NLA_HDRLEN || nla->nla_len > len)
+			return nullptr;
+		if ((nla->nla_type & NLA_TYPE_MASK) == type)
+			return nla;
+		cur += NLA_ALIGN(nla->nla_len);
+		len -= NLA_ALIGN(nla->nla_len);
+	}
+	return nullptr;
+}
+
+static int open_genl_socket() {
+	int sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+	if (sock == -1)
+		return -1;
+
+	struct sockaddr_nl addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+		close(sock);
+		return -1;
 	}
+	return sock;
+}
+
+// One socket per thread, so concurrent readers can't get each other's replies
+static int taskstats_socket() {
+	struct holder {
+		int fd = -1;
+		~holder() {
+			if (fd != -1)
+				close(fd);
+		}
+	};
+	static thread_local struct holder sock;
+	if (sock.fd == -1)
+		sock.fd = open_genl_socket();
+	return sock.fd;
+}
+
+bool TaskstatsSource::open() {
+	int sock = open_genl_socket();
+	if (sock == -1)
+		return false;
+
+	alignas(struct nlmsghdr) char reply[1024];
+	ssize_t len = -1;
+	if (send_genl(sock, GENL_ID_CTRL, CTRL_CMD_GETFAMILY, CTRL_ATTR_FAMILY_NAME,
+				  TASKSTATS_GENL_NAME, sizeof(TASKSTATS_GENL_NAME)))
+		len = recv(sock, reply, sizeof(reply), 0);
+	close(sock);
+
+	const struct nlmsghdr *header = (const struct nlmsghdr *)reply;
+	if (len <= 0 || !NLMSG_OK(header, len) || header->nlmsg_type == NLMSG_ERROR)
+		return false;
+
+	const char *attrs = (const char *)NLMSG_DATA(header) + GENL_HDRLEN;
+	const struct nlattr *id = find_attr(attrs, header->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN),
+										CTRL_ATTR_FAMILY_ID);
+	if (!id)
+		return false;
+
+	memcpy(&family, (const char *)id + NLA_HDRLEN, sizeof(family));
+	return family != 0;
 }
 
-void read_pid_stat(int32_t pid, struct pid_stat *stats) {
-	std::string filepath(std::string("/proc/") + std::to_string(pid) + "/stat");
-    std::ifstream infile(filepath);
-    if (!infile.is_open())
+bool TaskstatsSource::query(const int32_t pid, struct taskstats *stats) const {
+	int sock = taskstats_socket();
+	if (sock == -1)
+		return false;
+
+	uint32_t attr_pid = pid;
+	if (!send_genl(sock, family, TASKSTATS_CMD_GET, TASKSTATS_CMD_ATTR_PID, &attr_pid, sizeof(attr_pid)))
+		return false;
+
+	alignas(struct nlmsghdr) char reply[1024];
+	ssize_t len = recv(sock, reply, sizeof(reply), 0);
+	const struct nlmsghdr *header = (const struct nlmsghdr *)reply;
+	if (len <= 0 || !NLMSG_OK(header, len) || header->nlmsg_type != family)
+		return false;
+
+	// TASKSTATS_TYPE_AGGR_PID { TASKSTATS_TYPE_PID, TASKSTATS_TYPE_STATS }
+	const char *attrs = (const char *)NLMSG_DATA(header) + GENL_HDRLEN;
+	const struct nlattr *aggr = find_attr(attrs, header->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN),
+										  TASKSTATS_TYPE_AGGR_PID);
+	if (!aggr)
+		return false;
+	const struct nlattr *nested = find_attr((const char *)aggr + NLA_HDRLEN,
+											aggr->nla_len - NLA_HDRLEN, TASKSTATS_TYPE_STATS);
+	if (!nested)
+		return false;
+
+	// Older and newer kernels send a different struct size, the start is the same
+	size_t size = std::min<size_t>(nested->nla_len - NLA_HDRLEN, sizeof(*stats));
+	memset(stats, 0, sizeof(*stats));
+	memcpy(stats, (const char *)nested + NLA_HDRLEN, size);
+	return true;
+}
+
+bool TaskstatsSource::read_io(const int32_t pid, struct pid_io *io) const {
+	struct taskstats stats;
+	if (!query(pid, &stats))
+		return false;
+
+	io->rchar = stats.read_char;
+	io->wchar = stats.write_char;
+	io->syscr = stats.read_syscalls;
+	io->syscw = stats.write_syscalls;
+	io->read_bytes = stats.read_bytes;
+	io->write_bytes = stats.write_bytes;
+	io->cancelled_write_bytes = stats.cancelled_write_bytes;
+	return true;
+}
+
+void read_pid_net(const struct pid_handle *handle, std::vector<struct net_interface> *net_vec) {
+	std::string buf;
+	if (!read_pid_file(handle, "net/dev", &buf))
 		return;
 
-	infile >> stats->pid
-		>> stats->comm
-		>> stats->state
-		>> stats->ppid
-		>> stats->pgrp
-		>> stats->session
-		>> stats->tty_nr
-		>> stats->tpgid
-		>> stats->flags
-		>> stats->minflt
-		>> stats->cminflt
-		>> stats->majflt
-		>> stats->cmajflt
-		>> stats->utime
-		>> stats->stime
-		>> stats->cutime
-		>> stats->cstime
-		>> stats->priority
-		>> stats->nice
-		>> stats->num_threads
-		>> stats->itrealvalue
-		>> stats->starttime
-		>> stats->vsize
-		>> stats->rss
-		>> stats->rsslim
-		>> stats->startcode
-		>> stats->endcode
-		>> stats->startstack
-		>> stats->kstkesp
-		>> stats->kstkeip
-		>> stats->signal
-		>> stats->blocked
-		>> stats->sigignore
-		>> stats->sigcatch
-		>> stats->wchan
-		>> stats->nswap
-		>> stats->cnswap
-		>> stats->exit_signal
-		>> stats->processor
-		>> stats->rt_priority
-		>> stats->policy
-		>> stats->delayacct_blkio_ticks
-		>> stats->guest_time
-		>> stats->cguest_time;
-}
-
-void read_pid_statm(const int32_t pid, struct pid_statm *statm) {
-	std::string filepath(std::string("/proc/") + std::to_string(pid) + "/statm");
-    std::ifstream infile(filepath);
-    if (!infile.is_open())
+	parse_net_dev(buf, net_vec);
+}
+
+bool parse_pid_stat(const char *buf, const size_t len, struct pid_stat *stats) {
+	const char *cur = buf;
+	const char *end = buf + len;
+
+	if (!scan_int(cur, end, &stats->pid))
+		return false;
+
+	// comm can hold spaces and parentheses, it ends at the last ')'
+	const char *comm_start = static_cast<const char *>(memchr(cur, '(', end - cur));
+	const char *comm_end = end;
+	while (comm_end > cur && *(comm_end - 1) != ')')
+		comm_end--;
+	if (!comm_start || comm_end <= comm_start)
+		return false;
+	// Parentheses left out, same as /proc/{pid}/comm
+	size_t comm_len = std::min<size_t>(comm_end - comm_start - 2, sizeof(stats->comm) - 1);
+	memcpy(stats->comm, comm_start + 1, comm_len);
+	stats->comm[comm_len] = '\0';
+	stats->comm_len = comm_len;
+
+	cur = skip_spaces(comm_end, end);
+	if (cur == end)
+		return false;
+	stats->state = *cur++;
+
+	return scan_int(cur, end, &stats->ppid)
+		&& scan_int(cur, end, &stats->pgrp)
+		&& scan_int(cur, end, &stats->session)
+		&& scan_int(cur, end, &stats->tty_nr)
+		&& scan_int(cur, end, &stats->tpgid)
+		&& scan_int(cur, end, &stats->flags)
+		&& scan_int(cur, end, &stats->minflt)
+		&& scan_int(cur, end, &stats->cminflt)
+		&& scan_int(cur, end, &stats->majflt)
+		&& scan_int(cur, end, &stats->cmajflt)
+		&& scan_int(cur, end, &stats->utime)
+		&& scan_int(cur, end, &stats->stime)
+		&& scan_int(cur, end, &stats->cutime)
+		&& scan_int(cur, end, &stats->cstime)
+		&& scan_int(cur, end, &stats->priority)
+		&& scan_int(cur, end, &stats->nice)
+		&& scan_int(cur, end, &stats->num_threads)
+		&& scan_int(cur, end, &stats->itrealvalue)
+		&& scan_int(cur, end, &stats->starttime)
+		&& scan_int(cur, end, &stats->vsize)
+		&& scan_int(cur, end, &stats->rss)
+		&& scan_int(cur, end, &stats->rsslim)
+		&& scan_int(cur, end, &stats->startcode)
+		&& scan_int(cur, end, &stats->endcode)
+		&& scan_int(cur, end, &stats->startstack)
+		&& scan_int(cur, end, &stats->kstkesp)
+		&& scan_int(cur, end, &stats->kstkeip)
+		&& scan_int(cur, end, &stats->signal)
+		&& scan_int(cur, end, &stats->blocked)
+		&& scan_int(cur, end, &stats->sigignore)
+		&& scan_int(cur, end, &stats->sigcatch)
+		&& scan_int(cur, end, &stats->wchan)
+		&& scan_int(cur, end, &stats->nswap)
+		&& scan_int(cur, end, &stats->cnswap)
+		&& scan_int(cur, end, &stats->exit_signal)
+		&& scan_int(cur, end, &stats->processor)
+		&& scan_int(cur, end, &stats->rt_priority)
+		&& scan_int(cur, end, &stats->policy)
+		&& scan_int(cur, end, &stats->delayacct_blkio_ticks)
+		&& scan_int(cur, end, &stats->guest_time)
+		&& scan_int(cur, end, &stats->cguest_time);
+}
+
+bool read_pid_stat(const struct pid_handle *handle, struct pid_stat *stats) {
+	// A stat line is a few hundred bytes, even with a 64 char kthread comm
+	char buf[1024];
+	ssize_t len = read_pid_file(handle, "stat", buf, sizeof(buf));
+	if (len <= 0)
+		return false;
+
+	return parse_pid_stat(buf, len, stats);
+}
+
+void read_pid_statm(const struct pid_handle *handle, struct pid_statm *statm) {
+	char buf[256];
+	ssize_t len = read_pid_file(handle, "statm", buf, sizeof(buf));
+	if (len <= 0)
 		return;
 
-	infile >> statm->size
-		>> statm->resident
-		>> statm->share
-		>> statm->text
-		>> statm->lib
-		>> statm->data
-		>> statm->dt;
+	const char *cur = buf;
+	const char *end = buf + len;
+	scan_int(cur, end, &statm->size)
+		&& scan_int(cur, end, &statm->resident)
+		&& scan_int(cur, end, &statm->share)
+		&& scan_int(cur, end, &statm->text)
+		&& scan_int(cur, end, &statm->lib)
+		&& scan_int(cur, end, &statm->data)
+		&& scan_int(cur, end, &statm->dt);
 }
 
-void read_pid_status(const int32_t pid, struct pid_status *status) {
-	std::string filepath(std::string("/proc/") + std::to_string(pid) + "/status");
-    std::ifstream infile(filepath);
-    if (!infile.is_open())
+static constexpr field<struct pid_status> pid_status_fields[] = {
+	GROUP_FIELD_BASE(pid_status, Umask, "Umask", STATUS_IDS, 8),
+	GROUP_FIELD(pid_status, State, "State", STATUS_IDS),
+	GROUP_FIELD(pid_status, Tgid, "Tgid", STATUS_IDS),
+	GROUP_FIELD(pid_status, Ngid, "Ngid", STATUS_IDS),
+	GROUP_FIELD(pid_status, Pid, "Pid", STATUS_IDS),
+	GROUP_FIELD(pid_status, PPid, "PPid", STATUS_IDS),
+	GROUP_FIELD(pid_status, TracerPid, "TracerPid", STATUS_IDS),
+	GROUP_FIELD(pid_status, Uid, "Uid", STATUS_IDS),
+	GROUP_FIELD(pid_status, Gid, "Gid", STATUS_IDS),
+	GROUP_FIELD(pid_status, FDSize, "FDSize", STATUS_IDS),
+	GROUP_FIELD(pid_status, VmPeak, "VmPeak", STATUS_MEM),
+	GROUP_FIELD(pid_status, VmSize, "VmSize", STATUS_MEM),
+	GROUP_FIELD(pid_status, VmLck, "VmLck", STATUS_MEM),
+	GROUP_FIELD(pid_status, VmPin, "VmPin", STATUS_MEM),
+	GROUP_FIELD(pid_status, VmHWM, "VmHWM", STATUS_MEM),
+	GROUP_FIELD(pid_status, VmRSS, "VmRSS", STATUS_MEM),
+	GROUP_FIELD(pid_status, RssAnon, "RssAnon", STATUS_MEM),
+	GROUP_FIELD(pid_status, RssFile, "RssFile", STATUS_MEM),
+	GROUP_FIELD(pid_status, RssShmem, "RssShmem", STATUS_MEM),
+	GROUP_FIELD(pid_status, VmData, "VmData", STATUS_MEM),
+	GROUP_FIELD(pid_status, VmStk, "VmStk", STATUS_MEM),
+	GROUP_FIELD(pid_status, VmExe, "VmExe", STATUS_MEM),
+	GROUP_FIELD(pid_status, VmLib, "VmLib", STATUS_MEM),
+	GROUP_FIELD(pid_status, VmPTE, "VmPTE", STATUS_MEM),
+	GROUP_FIELD(pid_status, VmSwap, "VmSwap", STATUS_MEM),
+	GROUP_FIELD(pid_status, HugetlbPages, "HugetlbPages", STATUS_MEM),
+	GROUP_FIELD(pid_status, CoreDumping, "CoreDumping", STATUS_MEM),
+	GROUP_FIELD(pid_status, THP_enabled, "THP_enabled", STATUS_MEM),
+	GROUP_FIELD(pid_status, Threads, "Threads", STATUS_SCHED),
+	GROUP_FIELD(pid_status, voluntary_ctxt_switches, "voluntary_ctxt_switches", STATUS_SCHED),
+	GROUP_FIELD(pid_status, nonvoluntary_ctxt_switches, "nonvoluntary_ctxt_switches", STATUS_SCHED),
+	GROUP_FIELD_BASE(pid_status, SigPnd, "SigPnd", STATUS_SIGNALS, 16),
+	GROUP_FIELD_BASE(pid_status, ShdPnd, "ShdPnd", STATUS_SIGNALS, 16),
+	GROUP_FIELD_BASE(pid_status, SigBlk, "SigBlk", STATUS_SIGNALS, 16),
+	GROUP_FIELD_BASE(pid_status, SigIgn, "SigIgn", STATUS_SIGNALS, 16),
+	GROUP_FIELD_BASE(pid_status, SigCgt, "SigCgt", STATUS_SIGNALS, 16),
+	GROUP_FIELD_BASE(pid_status, CapInh, "CapInh", STATUS_SECURITY, 16),
+	GROUP_FIELD_BASE(pid_status, CapPrm, "CapPrm", STATUS_SECURITY, 16),
+	GROUP_FIELD_BASE(pid_status, CapEff, "CapEff", STATUS_SECURITY, 16),
+	GROUP_FIELD_BASE(pid_status, CapBnd, "CapBnd", STATUS_SECURITY, 16),
+	GROUP_FIELD_BASE(pid_status, CapAmb, "CapAmb", STATUS_SECURITY, 16),
+	GROUP_FIELD(pid_status, NoNewPrivs, "NoNewPrivs", STATUS_SECURITY),
+	GROUP_FIELD(pid_status, Seccomp, "Seccomp", STATUS_SECURITY),
+	GROUP_FIELD(pid_status, Seccomp_filters, "Seccomp_filters", STATUS_SECURITY),
+};
+static constexpr FieldTable<struct pid_status, std::size(pid_status_fields)> pid_status_table(pid_status_fields);
+static_assert(pid_status_table.valid(), "No perfect hash for pid_status keys");
+
+void read_pid_status(const struct pid_handle *handle, const uint32_t fields, struct pid_status *status) {
+	char buf[8192];
+	ssize_t len = read_pid_file(handle, "status", buf, sizeof(buf));
+	if (len <= 0)
 		return;
 
-	const std::string Name__str = "Name";
-	const std::string Umask__str = "Umask";
-	const std::string State__str = "State";
-	const std::string Tgid__str = "Tgid";
-	const std::string Ngid__str = "Ngid";
-	const std::string Pid__str = "Pid";
-	const std::string PPid__str = "PPid";
-	const std::string TracerPid__str = "TracerPid";
-	const std::string Uid__str = "Uid";
-	const std::string Gid__str = "Gid";
-	const std::string FDSize__str = "FDSize";
-	const std::string Groups__str = "Groups";
-	const std::string NStgid__str = "NStgid";
-	const std::string NSpid__str = "NSpid";
-	const std::string NSpgid__str = "NSpgid";
-	const std::string NSsid__str = "NSsid";
-	const std::string VmPeak__str = "VmPeak";
-	const std::string VmSize__str = "VmSize";
-	const std::string VmLck__str = "VmLck";
-	const std::string VmPin__str = "VmPin";
-	const std::string VmHWM__str = "VmHWM";
-	const std::string VmRSS__str = "VmRSS";
-	const std::string RssAnon__str = "RssAnon";
-	const std::string RssFile__str = "RssFile";
-	const std::string RssShmem__str = "RssShmem";
-	const std::string VmData__str = "VmData";
-	const std::string VmStk__str = "VmStk";
-	const std::string VmExe__str = "VmExe";
-	const std::string VmLib__str = "VmLib";
-	const std::string VmPTE__str = "VmPTE";
-	const std::string VmSwap__str = "VmSwap";
-	const std::string HugetlbPages__str = "HugetlbPages";
-	const std::string CoreDumping__str = "CoreDumping";
-	const std::string THP_enabled__str = "THP_enabled";
-	const std::string Threads__str = "Threads";
-	const std::string SigQ__str = "SigQ";
-	const std::string SigPnd__str = "SigPnd";
-	const std::string ShdPnd__str = "ShdPnd";
-	const std::string SigBlk__str = "SigBlk";
-	const std::string SigIgn__str = "SigIgn";
-	const std::string SigCgt__str = "SigCgt";
-	const std::string CapInh__str = "CapInh";
-	const std::string CapPrm__str = "CapPrm";
-	const std::string CapEff__str = "CapEff";
-	const std::string CapBnd__str = "CapBnd";
-	const std::string CapAmb__str = "CapAmb";
-	const std::string NoNewPrivs__str = "NoNewPrivs";
-	const std::string Seccomp__str = "Seccomp";
-	const std::string Seccomp_filters__str = "Seccomp_filters";
-	const std::string Speculation_Store_Bypass__str = "Speculation_Store_Bypass";
-	const std::string SpeculationIndirectBranch__str = "SpeculationIndirectBranch";
-	const std::string Cpus_allowed__str = "Cpus_allowed";
-	const std::string Cpus_allowed_list__str = "Cpus_allowed_list";
-	const std::string Mems_allowed__str = "Mems_allowed";
-	const std::string Mems_allowed_list__str = "Mems_allowed_list";
-	const std::string voluntary_ctxt_switches__str = "voluntary_ctxt_switches";
-	const std::string nonvoluntary_ctxt_switches__str = "nonvoluntary_ctxt_switches";
-
-    std::string line;
-    std::string type;
-    std::string value;
-    int delim_pos;
-    while (std::getline(infile, line)) {
-        delim_pos = line.find_first_of(":");
-        type = line.substr(0, delim_pos);
-        line = line.substr(delim_pos+1);
-        delim_pos = line.find_first_not_of(" \t");
-		if (delim_pos != -1)
-	        value = line.substr(delim_pos);
-		else
-			value = line;
-
-		if (type == Name__str) {
-			status->Name = value;
-		} else if (type == Umask__str) {
-			status->Umask = value;
-		} else if (type == State__str) {
-			status->State = value;
-		} else if (type == Tgid__str) {
-			status->Tgid = value;
-		} else if (type == Ngid__str) {
-			status->Ngid = value;
-		} else if (type == Pid__str) {
-			status->Pid = value;
-		} else if (type == PPid__str) {
-			status->PPid = value;
-		} else if (type == TracerPid__str) {
-			status->TracerPid = value;
-		} else if (type == Uid__str) {
-			status->Uid = value;
-		} else if (type == Gid__str) {
-			status->Gid = value;
-		} else if (type == FDSize__str) {
-			status->FDSize = value;
-		} else if (type == Groups__str) {
-			status->Groups = value;
-		} else if (type == NStgid__str) {
-			status->NStgid = value;
-		} else if (type == NSpid__str) {
-			status->NSpid = value;
-		} else if (type == NSpgid__str) {
-			status->NSpgid = value;
-		} else if (type == NSsid__str) {
-			status->NSsid = value;
-		} else if (type == VmPeak__str) {
-			status->VmPeak = value;
-		} else if (type == VmSize__str) {
-			status->VmSize = value;
-		} else if (type == VmLck__str) {
-			status->VmLck = value;
-		} else if (type == VmPin__str) {
-			status->VmPin = value;
-		} else if (type == VmHWM__str) {
-			status->VmHWM = value;
-		} else if (type == VmRSS__str) {
-			status->VmRSS = value;
-		} else if (type == RssAnon__str) {
-			status->RssAnon = value;
-		} else if (type == RssFile__str) {
-			status->RssFile = value;
-		} else if (type == RssShmem__str) {
-			status->RssShmem = value;
-		} else if (type == VmData__str) {
-			status->VmData = value;
-		} else if (type == VmStk__str) {
-			status->VmStk = value;
-		} else if (type == VmExe__str) {
-			status->VmExe = value;
-		} else if (type == VmLib__str) {
-			status->VmLib = value;
-		} else if (type == VmPTE__str) {
-			status->VmPTE = value;
-		} else if (type == VmSwap__str) {
-			status->VmSwap = value;
-		} else if (type == HugetlbPages__str) {
-			status->HugetlbPages = value;
-		} else if (type == CoreDumping__str) {
-			status->CoreDumping = value;
-		} else if (type == THP_enabled__str) {
-			status->THP_enabled = value;
-		} else if (type == Threads__str) {
-			status->Threads = value;
-		} else if (type == SigQ__str) {
-			status->SigQ = value;
-		} else if (type == SigPnd__str) {
-			status->SigPnd = value;
-		} else if (type == ShdPnd__str) {
-			status->ShdPnd = value;
-		} else if (type == SigBlk__str) {
-			status->SigBlk = value;
-		} else if (type == SigIgn__str) {
-			status->SigIgn = value;
-		} else if (type == SigCgt__str) {
-			status->SigCgt = value;
-		} else if (type == CapInh__str) {
-			status->CapInh = value;
-		} else if (type == CapPrm__str) {
-			status->CapPrm = value;
-		} else if (type == CapEff__str) {
-			status->CapEff = value;
-		} else if (type == CapBnd__str) {
-			status->CapBnd = value;
-		} else if (type == CapAmb__str) {
-			status->CapAmb = value;
-		} else if (type == NoNewPrivs__str) {
-			status->NoNewPrivs = value;
-		} else if (type == Seccomp__str) {
-			status->Seccomp = value;
-		} else if (type == Seccomp_filters__str) {
-			status->Seccomp_filters = value;
-		} else if (type == Speculation_Store_Bypass__str) {
-			status->Speculation_Store_Bypass = value;
-		} else if (type == SpeculationIndirectBranch__str) {
-			status->SpeculationIndirectBranch = value;
-		} else if (type == Cpus_allowed__str) {
-			status->Cpus_allowed = value;
-		} else if (type == Cpus_allowed_list__str) {
-			status->Cpus_allowed_list = value;
-		} else if (type == Mems_allowed__str) {
-			status->Mems_allowed = value;
-		} else if (type == Mems_allowed_list__str) {
-			status->Mems_allowed_list = value;
-		} else if (type == voluntary_ctxt_switches__str) {
-			status->voluntary_ctxt_switches = value;
-		} else if (type == nonvoluntary_ctxt_switches__str) {
-			status->nonvoluntary_ctxt_switches = value;
-		}
-	}
+	// Every key shows up once, the rest of the file can be skipped once
+	// the asked for ones have all been seen
+	size_t left = pid_status_table.count(fields);
+	const char *cur = buf;
+	std::string_view line;
+	while (left && next_line(cur, buf + len, &line))
+		if (dispatch_line(pid_status_table, status, line, ":", fields))
+			left--;
+	status->fields |= fields;
 }
 
 void get_uptime(uint64_t *uptime) {
-	std::string filepath("/proc/uptime");
-    std::ifstream infile(filepath);
-    if (!infile.is_open())
-        return;
-
-    infile >> *uptime;
-}
-
-void get_pid_uptime(const uint64_t pid, uint64_t *pid_uptime) {
-    struct pid_stat stats = { 0 };
-    read_pid_stat(pid, &stats);
-    // Convert from ticks to seconds
-    uint32_t ticks_per_s = sysconf(_SC_CLK_TCK);
-    // Start time in seconds since boot
-    uint64_t system_uptime = 0;
-    get_uptime(&system_uptime);
-    stats.starttime = stats.starttime / ticks_per_s;
-    *pid_uptime = system_uptime - stats.starttime;
+	static ProcFile file("/proc/uptime");
+	if (!file.read())
+		return;
+
+	// Whole seconds, the fraction is left out
+	std::string_view contents = file.contents();
+	const char *cur = contents.data();
+	scan_int(cur, contents.data() + contents.size(), uptime);
+}
+
+uint64_t monotonic_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
 }
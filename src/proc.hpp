@@ -1,8 +1,12 @@
 #ifndef PROC_HPP_
 #define PROC_HPP_
 
+#include "pid_handle.hpp"
+
 #include <iostream>
+#include <string_view>
 #include <vector>
+#include <memory> // shared_ptr
 #include <cstdint>
 
 extern "C" {
@@ -61,18 +65,67 @@ struct cpu_stat {
 	// (10) Time spent running a niced guest (virtual CPU for guest operating systems under the control of the Linux kernel).
 	uint64_t guest_nice;
 
-    uint64_t total() {
+    uint64_t total() const {
         // Guest time is already accounted in user
-        user -= guest;
-        nice -= guest_nice;
+        uint64_t usertime = user - guest;
+        uint64_t nicetime = nice - guest_nice;
         uint64_t idlealltime = idle + iowait;
         uint64_t systemalltime = system + irq + softirq;
         uint64_t virtalltime = guest + guest_nice;
-        uint64_t totaltime = user + nice + systemalltime + idlealltime + steal + virtalltime;
+        uint64_t totaltime = usertime + nicetime + systemalltime + idlealltime + steal + virtalltime;
         return totaltime;
     }
 };
 
+// The cpuN lines of /proc/stat, with an array per field instead of a
+// cpu_stat per core so deltas are computed over contiguous memory
+struct cpu_core_stats {
+	// N of cpuN, offline cores are left out by the kernel
+	std::vector<uint32_t> id;
+	std::vector<uint64_t> user;
+	std::vector<uint64_t> nice;
+	std::vector<uint64_t> system;
+	std::vector<uint64_t> idle;
+	std::vector<uint64_t> iowait;
+	std::vector<uint64_t> irq;
+	std::vector<uint64_t> softirq;
+	std::vector<uint64_t> steal;
+
+	size_t size() const {
+		return id.size();
+	}
+	void resize(const size_t n) {
+		id.resize(n);
+		user.resize(n);
+		nice.resize(n);
+		system.resize(n);
+		idle.resize(n);
+		iowait.resize(n);
+		irq.resize(n);
+		softirq.resize(n);
+		steal.resize(n);
+	}
+};
+
+// Share of each core's time between two cpu_core_stats reads, 0 to 1
+struct cpu_core_usage {
+	// user and nice, guest time included
+	std::vector<float> user;
+	// system, irq and softirq
+	std::vector<float> system;
+	std::vector<float> iowait;
+	std::vector<float> steal;
+
+	size_t size() const {
+		return user.size();
+	}
+};
+
+// Usage of every core between previous and current, 0 for cores that
+// went on or offline in between
+void cpu_core_delta(const struct cpu_core_stats &previous, const struct cpu_core_stats &current,
+					struct cpu_core_usage *usage);
+
 // Values are in kB
 struct meminfo {
 	uint32_t MemTotal = 0;
@@ -197,8 +250,10 @@ struct net_interface {
 struct pid_stat {
     // (1) The process ID.
 	int32_t pid = 0;
-    // (2) The filename of the executable, in parentheses. This is visible whether or not the executable is swapped out.
-	std::string comm = "";
+    // (2) The filename of the executable. This is visible whether or not the executable is swapped out.
+    // Without the parentheses, cut to fit and null terminated.
+	char comm[64] = "";
+	uint8_t comm_len = 0;
     // (3) One character from the string "RSDZTW" where R is running, S is sleeping in an interruptible wait, D is waiting in uninterruptible disk sleep, Z is zombie, T is traced or stopped (on a signal), and W is paging.
 	char state = 'T';
     // (4) The PID of the parent.
@@ -303,79 +358,273 @@ struct pid_statm {
 	uint32_t dt = 0;
 };
 
+// Groups of /proc/{pid}/status fields, read_pid_status() only parses the
+// ones asked for and stops reading once it has them
+#define STATUS_IDS		(1 << 0)	// Umask to FDSize
+#define STATUS_MEM		(1 << 1)	// Vm*, Rss*, HugetlbPages, CoreDumping, THP_enabled
+#define STATUS_SCHED	(1 << 2)	// Threads and context switches
+#define STATUS_SIGNALS	(1 << 3)	// SigPnd to SigCgt
+#define STATUS_SECURITY	(1 << 4)	// Capabilities, NoNewPrivs, Seccomp
+#define STATUS_ALL		((1 << 5) - 1)
+
+// Lists and text, like Groups, NSpid, Cpus_allowed_list or the Speculation
+// lines, are left out. Name is the comm of /proc/{pid}/stat.
 struct pid_status {
-	std::string Name = "";
-	std::string Umask = "";
-	std::string State = "";
-	std::string Tgid = "";
-	std::string Ngid = "";
-	std::string Pid = "";
-	std::string PPid = "";
-	std::string TracerPid = "";
-	std::string Uid = "";
-	std::string Gid = "";
-	std::string FDSize = "";
-	std::string Groups = "";
-	std::string NStgid = "";
-	std::string NSpid = "";
-	std::string NSpgid = "";
-	std::string NSsid = "";
-	std::string VmPeak = "";
-	std::string VmSize = "";
-	std::string VmLck = "";
-	std::string VmPin = "";
-	std::string VmHWM = "";
-	std::string VmRSS = "";
-	std::string RssAnon = "";
-	std::string RssFile = "";
-	std::string RssShmem = "";
-	std::string VmData = "";
-	std::string VmStk = "";
-	std::string VmExe = "";
-	std::string VmLib = "";
-	std::string VmPTE = "";
-	std::string VmSwap = "";
-	std::string HugetlbPages = "";
-	std::string CoreDumping = "";
-	std::string THP_enabled = "";
-	std::string Threads = "";
-	std::string SigQ = "";
-	std::string SigPnd = "";
-	std::string ShdPnd = "";
-	std::string SigBlk = "";
-	std::string SigIgn = "";
-	std::string SigCgt = "";
-	std::string CapInh = "";
-	std::string CapPrm = "";
-	std::string CapEff = "";
-	std::string CapBnd = "";
-	std::string CapAmb = "";
-	std::string NoNewPrivs = "";
-	std::string Seccomp = "";
-	std::string Seccomp_filters = "";
-	std::string Speculation_Store_Bypass = "";
-	std::string SpeculationIndirectBranch = "";
-	std::string Cpus_allowed = "";
-	std::string Cpus_allowed_list = "";
-	std::string Mems_allowed = "";
-	std::string Mems_allowed_list = "";
-	std::string voluntary_ctxt_switches = "";
-	std::string nonvoluntary_ctxt_switches = "";
+	// STATUS_* groups that were parsed
+	uint32_t fields = 0;
+
+	// STATUS_IDS
+	uint32_t Umask = 0;
+	// R, S, D, ...
+	char State = 0;
+	uint32_t Tgid = 0;
+	uint32_t Ngid = 0;
+	uint32_t Pid = 0;
+	uint32_t PPid = 0;
+	uint32_t TracerPid = 0;
+	// Real, effective, saved set and filesystem
+	uint32_t Uid[4] = {};
+	uint32_t Gid[4] = {};
+	uint32_t FDSize = 0;
+
+	// STATUS_MEM, in kB
+	uint64_t VmPeak = 0;
+	uint64_t VmSize = 0;
+	uint64_t VmLck = 0;
+	uint64_t VmPin = 0;
+	uint64_t VmHWM = 0;
+	uint64_t VmRSS = 0;
+	uint64_t RssAnon = 0;
+	uint64_t RssFile = 0;
+	uint64_t RssShmem = 0;
+	uint64_t VmData = 0;
+	uint64_t VmStk = 0;
+	uint64_t VmExe = 0;
+	uint64_t VmLib = 0;
+	uint64_t VmPTE = 0;
+	uint64_t VmSwap = 0;
+	uint64_t HugetlbPages = 0;
+	uint8_t CoreDumping = 0;
+	uint8_t THP_enabled = 0;
+
+	// STATUS_SCHED
+	uint32_t Threads = 0;
+	uint64_t voluntary_ctxt_switches = 0;
+	uint64_t nonvoluntary_ctxt_switches = 0;
+
+	// STATUS_SIGNALS, bit n-1 is signal n
+	uint64_t SigPnd = 0;
+	uint64_t ShdPnd = 0;
+	uint64_t SigBlk = 0;
+	uint64_t SigIgn = 0;
+	uint64_t SigCgt = 0;
+
+	// STATUS_SECURITY, capability masks
+	uint64_t CapInh = 0;
+	uint64_t CapPrm = 0;
+	uint64_t CapEff = 0;
+	uint64_t CapBnd = 0;
+	uint64_t CapAmb = 0;
+	uint8_t NoNewPrivs = 0;
+	uint8_t Seccomp = 0;
+	uint32_t Seccomp_filters = 0;
 };
 
 struct process {
 	uint64_t			pid = 0;
-	std::string			name = "";
-	std::string			cmd = "";
+	// From /proc/{pid}/stat, tells apart processes with a reused pid
+	uint64_t			starttime = 0;
+	// From the comm field of /proc/{pid}/stat, fixed so a tick doesn't allocate
+	char				name[64] = "";
 	bool				is_alive = false;
 };
 
-void find_processes(std::vector<struct process> *processes);
+// Global procfs file, opened once and re-read from the start with pread().
+// Not thread safe, every file has a single reader.
+class ProcFile {
+public:
+	ProcFile(const char *path);
+	~ProcFile();
+
+	// Re-read the whole file, false if it couldn't be read
+	bool read();
+	// Contents as of the last read()
+	std::string_view contents() const {
+		return std::string_view(buf.data(), len);
+	}
+private:
+	const char *path;
+	int fd = -1;
+	// Grows to fit the file and is then reused
+	std::string buf;
+	size_t len = 0;
+};
+
+struct taskstats;
+
+// Per-process accounting from the kernel's TASKSTATS genetlink family,
+// a binary reply per pid instead of a text file to parse
+class TaskstatsSource {
+public:
+	TaskstatsSource() {};
+	~TaskstatsSource() {};
+
+	// Look up the genetlink family, false if the kernel doesn't provide it
+	bool open();
+	bool is_open() const {
+		return family != 0;
+	}
+
+	// Counters of /proc/{pid}/io, false if they couldn't be read. Taskstats
+	// reports io per thread and leaves out reaped children, which procfs
+	// folds into the parent, so this only suits single threaded processes.
+	// Safe to call from several threads.
+	bool read_io(const int32_t pid, struct pid_io *io) const;
+private:
+	bool query(const int32_t pid, struct taskstats *stats) const;
+
+	uint16_t family = 0;
+};
+
+// Raw per-pid data, read once per tick and shared by all tabs
+struct process_sample {
+	struct process		process = {};
+	struct pid_stat		stat = {};
+	struct pid_statm	statm = {};
+	struct pid_io		io = {};
+	struct pid_status	status = {};
+	// io switched from taskstats to procfs on this read
+	bool				io_rebased = false;
+};
+
+// Metric groups, a bit mask of what a tab needs per tick.
+// The per-pid files are read by the collector, stat always is.
+#define METRIC_STAT		(1 << 0)	// /proc/{pid}/stat
+#define METRIC_STATM	(1 << 1)	// /proc/{pid}/statm
+#define METRIC_IO		(1 << 2)	// /proc/{pid}/io
+#define METRIC_STATUS	(1 << 3)	// /proc/{pid}/status
+// Gathered by the tabs themselves when the snapshot says they're due
+#define METRIC_FDINFO	(1 << 4)	// DRM fdinfo of gpu clients
+#define METRIC_SOCKETS	(1 << 5)	// Open sockets through lsof
+#define METRIC_ALL		((1 << 6) - 1)
+
+// Hot per-process numbers of a snapshot as columns, so sorting and summing
+// scans dense arrays instead of whole samples. Index i of every column is
+// the process at index i of the snapshot, names and other strings stay in
+// the samples.
+struct process_metrics {
+	std::vector<uint64_t> pid;
+	std::vector<uint64_t> starttime; // in clock ticks
+	std::vector<uint64_t> utime; // in clock ticks
+	std::vector<uint64_t> stime; // in clock ticks
+	std::vector<uint64_t> rss; // in B
+	std::vector<uint64_t> vsize; // in B
+	// Carried over from the previous snapshot on ticks io isn't collected
+	std::vector<uint64_t> read_bytes;
+	std::vector<uint64_t> write_bytes;
+	// CLOCK_MONOTONIC of the io counters, in ns
+	std::vector<uint64_t> io_ns;
+	// Since the previous snapshot, or over the whole lifetime for new processes
+	std::vector<float> cpu_usage; // in %
+	std::vector<float> read_per_s; // B/s
+	std::vector<float> write_per_s; // B/s
+
+	size_t size() const {
+		return pid.size();
+	}
+	void resize(const size_t n) {
+		pid.resize(n);
+		starttime.resize(n);
+		utime.resize(n);
+		stime.resize(n);
+		rss.resize(n);
+		vsize.resize(n);
+		read_bytes.resize(n);
+		write_bytes.resize(n);
+		io_ns.resize(n);
+		cpu_usage.resize(n);
+		read_per_s.resize(n);
+		write_per_s.resize(n);
+	}
+};
+
+// One tick worth of process data, never changed once it's published
+struct snapshot_data {
+	// Sorted by pid
+	std::vector<struct process_sample> processes;
+	// Same order as processes
+	struct process_metrics metrics;
+	// System uptime when it was collected, in seconds
+	uint64_t uptime = 0;
+	// CLOCK_MONOTONIC when it was collected, in nanoseconds
+	uint64_t timestamp_ns = 0;
+	// Sorted pids that proc events reported an exec or rename of
+	std::vector<int32_t> changed;
+	// Metric groups collected for this tick
+	uint32_t groups = 0;
+	// Collected for every tab and not just the visible one
+	bool full = false;
+};
+
+// The UI thread's read-only view of the latest published snapshot_data.
+// It only moves on to newer data in refresh(), so every tab sees the same
+// tick for a whole update.
+class ProcessSnapshot {
+public:
+	ProcessSnapshot();
+	~ProcessSnapshot() {};
+
+	// Switch over to latest, true if it's newer than the current data
+	bool refresh(std::shared_ptr<const struct snapshot_data> latest);
 
-// Get data from /proc/{pid}/cmdline
-void get_calling_command(const int32_t pid, std::string *cmd);
-// Get data from /proc/{pid}/comm
-void get_process_name(const int32_t pid, std::string *name);
+	// Sorted by pid
+	const std::vector<struct process_sample> &get_processes() const {
+		return data->processes;
+	}
+	// Hot numbers of get_processes() as columns, in the same order
+	const struct process_metrics &get_process_metrics() const {
+		return data->metrics;
+	}
+	// Position of sample in get_processes() and its metrics columns
+	size_t index_of(const struct process_sample *sample) const {
+		return sample - data->processes.data();
+	}
+	// nullptr if pid wasn't alive when the snapshot was collected
+	const struct process_sample *find(const uint64_t pid) const;
+	// System uptime when the snapshot was collected, in seconds
+	uint64_t get_uptime() const {
+		return data->uptime;
+	}
+	// CLOCK_MONOTONIC when the snapshot was collected, in nanoseconds.
+	// Rates are computed against this rather than the whole second uptime.
+	uint64_t get_timestamp_ns() const {
+		return data->timestamp_ns;
+	}
+	// Time since the process started, in seconds
+	uint64_t get_pid_uptime(const struct process_sample *sample) const;
+	// True if proc events reported an exec or rename of pid for this snapshot
+	bool exec_seen(const uint64_t pid) const;
+	// True if all of the metric groups in metrics were collected
+	bool has_metrics(const uint32_t metrics) const {
+		return (data->groups & metrics) == metrics;
+	}
+	// True if the snapshot was collected for hidden tabs too
+	bool is_full() const {
+		return data->full;
+	}
+	// Signal a pid without racing against pid reuse where the kernel allows
+	int send_signal(const uint64_t pid, const int sig) const;
+private:
+	std::shared_ptr<const struct snapshot_data> data;
+	uint32_t ticks_per_s = 0;
+};
+
+// List the pids in /proc
+void find_processes(std::vector<int32_t> *pids);
+
+// Get data from /proc/{pid}/cmdline, arguments separated by spaces and
+// cut off after max_len bytes
+void get_calling_command(const struct pid_handle *handle, std::string *cmd, const size_t max_len);
 // Get data from /proc/cpuinfo // x86_64 Linux version
 void read_cpuinfo(std::vector<struct cpuinfo_core> *info);
 // Get data from /proc/meminfo
@@ -384,19 +633,25 @@ void read_meminfo(struct meminfo *info);
 void read_net_dev(std::vector<struct net_interface> *net_vec);
 // Get data from /proc/stat
 void read_cpu_stat(struct cpu_stat *stats);
+// Get the per-core lines of /proc/stat
+void read_cpu_core_stats(struct cpu_core_stats *stats);
 // Get data from /proc/{pid}/io
-void read_pid_io(const int32_t pid, struct pid_io *io);
+void read_pid_io(const struct pid_handle *handle, struct pid_io *io);
+// Get data from /proc/thread-self/io, the counters of the calling thread
+void read_thread_io(struct pid_io *io);
 // Get data from /proc/{pid}/net/dev
-void read_pid_net(const int32_t pid, std::vector<struct net_interface> *net_vec);
-// Get data from /proc/{pid}/stat
-void read_pid_stat(const int32_t pid, struct pid_stat *stats);
+void read_pid_net(const struct pid_handle *handle, std::vector<struct net_interface> *net_vec);
+// Get data from /proc/{pid}/stat, false if the process is gone
+bool read_pid_stat(const struct pid_handle *handle, struct pid_stat *stats);
+// Parse the contents of /proc/{pid}/stat, false if it's malformed
+bool parse_pid_stat(const char *buf, const size_t len, struct pid_stat *stats);
 // Get data from /proc/{pid}/statm
-void read_pid_statm(const int32_t pid, struct pid_statm *statm);
-// Get data from /proc/{pid}/status
-void read_pid_status(const int32_t pid, struct pid_status *status);
+void read_pid_statm(const struct pid_handle *handle, struct pid_statm *statm);
+// Get the STATUS_* groups in fields from /proc/{pid}/status
+void read_pid_status(const struct pid_handle *handle, const uint32_t fields, struct pid_status *status);
 // Get data from /proc/uptime
 void get_uptime(uint64_t *usage); // in seconds
-
-void get_pid_uptime(const uint64_t pid, uint64_t *pid_uptime);
+// CLOCK_MONOTONIC in nanoseconds, for the interval between two samples
+uint64_t monotonic_ns();
 
 #endif // PROC_HPP_
@@ -0,0 +1,129 @@
+#include "proc_events.hpp"
+#include "proc.hpp"
+
+#include <algorithm> // std::sort, std::unique
+#include <cerrno>
+#include <cstring> // memset, memcpy
+
+extern "C" {
+	#include <unistd.h> // close()
+	#include <sys/socket.h>
+	#include <linux/netlink.h>
+	#include <linux/connector.h>
+	#include <linux/cn_proc.h>
+}
+
+ProcEvents::~ProcEvents() {
+	if (sock != -1)
+		close(sock);
+}
+
+bool ProcEvents::open() {
+	sock = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+	if (sock == -1)
+		return false;
+
+	struct sockaddr_nl addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = CN_IDX_PROC;
+	addr.nl_pid = 0;
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+		close(sock);
+		sock = -1;
+		return false;
+	}
+
+	// nlmsghdr, cn_msg and the listen op back to back
+	alignas(struct nlmsghdr) char request[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op))];
+	memset(request, 0, sizeof(request));
+	struct nlmsghdr *header = (struct nlmsghdr *)request;
+	header->nlmsg_len = sizeof(request);
+	header->nlmsg_type = NLMSG_DONE;
+	struct cn_msg *message = (struct cn_msg *)NLMSG_DATA(header);
+	message->id.idx = CN_IDX_PROC;
+	message->id.val = CN_VAL_PROC;
+	message->len = sizeof(enum proc_cn_mcast_op);
+	enum proc_cn_mcast_op op = PROC_CN_MCAST_LISTEN;
+	memcpy(message->data, &op, sizeof(op));
+	if (send(sock, request, sizeof(request), 0) == -1) {
+		close(sock);
+		sock = -1;
+		return false;
+	}
+
+	// Subscribed first, so nothing that happens during the scan gets lost
+	rescan();
+	return true;
+}
+
+void ProcEvents::rescan() {
+	std::vector<int32_t> pids;
+	find_processes(&pids);
+	live.clear();
+	live.insert(pids.begin(), pids.end());
+	did_rescan = true;
+}
+
+bool ProcEvents::read_events() {
+	alignas(struct nlmsghdr) char buf[8192];
+	while (true) {
+		ssize_t len = recv(sock, buf, sizeof(buf), 0);
+		if (len == -1) {
+			if (errno == EINTR)
+				continue;
+			// Socket buffer overflowed, some events are gone
+			return errno != ENOBUFS;
+		}
+
+		for (struct nlmsghdr *header = (struct nlmsghdr *)buf; NLMSG_OK(header, len);
+			 header = NLMSG_NEXT(header, len)) {
+			if (header->nlmsg_type == NLMSG_NOOP)
+				continue;
+			if (header->nlmsg_type == NLMSG_ERROR || header->nlmsg_type == NLMSG_OVERRUN)
+				return false;
+
+			struct cn_msg *message = (struct cn_msg *)NLMSG_DATA(header);
+			if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC)
+				continue;
+
+			struct proc_event *event = (struct proc_event *)message->data;
+			switch (event->what) {
+			case proc_event::PROC_EVENT_FORK:
+				// New threads show up as forks too, only processes are listed
+				if (event->event_data.fork.child_pid == event->event_data.fork.child_tgid)
+					live.insert(event->event_data.fork.child_tgid);
+				break;
+			case proc_event::PROC_EVENT_EXEC:
+				changed.push_back(event->event_data.exec.process_tgid);
+				break;
+			case proc_event::PROC_EVENT_COMM:
+				changed.push_back(event->event_data.comm.process_tgid);
+				break;
+			case proc_event::PROC_EVENT_EXIT:
+				if (event->event_data.exit.process_pid == event->event_data.exit.process_tgid)
+					live.erase(event->event_data.exit.process_tgid);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+}
+
+void ProcEvents::update(std::vector<int32_t> *pids) {
+	changed.clear();
+	did_rescan = false;
+	if (!read_events()) {
+		// Drop whatever is still queued, the rescan covers it
+		char discard[8192];
+		while (recv(sock, discard, sizeof(discard), 0) > 0 || errno == ENOBUFS)
+			;
+		rescan();
+	}
+
+	std::sort(changed.begin(), changed.end());
+	changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+	pids->assign(live.begin(), live.end());
+}
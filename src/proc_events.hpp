@@ -0,0 +1,52 @@
+#ifndef PROC_EVENTS_HPP_
+#define PROC_EVENTS_HPP_
+
+#include <vector>
+#include <unordered_set>
+#include <cstdint>
+
+/* Live pid set kept up to date from the kernel's proc connector
+ * (NETLINK_CONNECTOR, CN_IDX_PROC) instead of a readdir of /proc per tick.
+ * Fork and exit events add and remove pids, exec and comm events mark the
+ * pids whose name and command line have to be read again.
+ * Needs root and a kernel with CONFIG_PROC_EVENTS.
+ */
+class ProcEvents {
+public:
+	ProcEvents() {};
+	~ProcEvents();
+
+	// Subscribe to process events, false if the kernel won't send them
+	bool open();
+	bool is_open() const {
+		return sock != -1;
+	}
+
+	// Apply all pending events and fill pids with the live set.
+	// Falls back to a full rescan of /proc if events were lost.
+	void update(std::vector<int32_t> *pids);
+	// Take pid out of the live set, for a process found gone without its
+	// exit event. A late exit event for it is a no-op.
+	void forget(const int32_t pid) {
+		live.erase(pid);
+	}
+	// Sorted pids that exec'd or were renamed since the previous update
+	const std::vector<int32_t> &get_changed() const {
+		return changed;
+	}
+	// True if the last update rescanned /proc, nothing can be assumed unchanged then
+	bool rescanned() const {
+		return did_rescan;
+	}
+private:
+	// Drain the socket, false if the kernel dropped events
+	bool read_events();
+	void rescan();
+
+	int sock = -1;
+	std::unordered_set<int32_t> live;
+	std::vector<int32_t> changed;
+	bool did_rescan = false;
+};
+
+#endif // PROC_EVENTS_HPP_
@@ -0,0 +1,165 @@
+#ifndef PROCESS_TABLE_HPP_
+#define PROCESS_TABLE_HPP_
+
+#include "reconcile.hpp"
+#include "proc.hpp"
+#include "util.hpp"
+#include "stats.hpp"
+
+#include <vector>
+#include <algorithm> // std::partial_sort
+#include <utility> // std::pair
+#include <cstdint>
+
+/* Rows of a tab's process table, kept in a slot arena.
+ * Slots never move, dead ones are reused through a free list, so a
+ * steady set of processes doesn't allocate anything on update.
+ *
+ * A Sampler policy provides:
+ *   typedef ... source;
+ *       What rows are built from, one per process per update
+ *   struct pid_key key(const source &src);
+ *       Identity of the process behind src
+ *   void init(Row *row, const source &src);
+ *       Called once when the process first shows up
+ *   void sample(Row *row, const source &src);
+ *       Called on every update the process is alive, including the first
+ */
+template<typename Row, typename Sampler>
+class ProcessTable {
+public:
+    typedef typename Sampler::source source;
+
+    ProcessTable(Sampler sampler = Sampler()) : sampler(sampler) {};
+    ~ProcessTable() {};
+
+    void update(const std::vector<source> &sources) {
+        previous.clear();
+        for (uint32_t slot : order)
+            previous.push_back(slot_keys[slot]);
+        current.clear();
+        for (const source &src : sources)
+            current.push_back(sampler.key(src));
+        reconciler.reconcile(previous, current, &reconciled);
+
+        for (uint32_t i : reconciled.removed)
+            free_slots.push_back(order[i]);
+
+        next_order.clear();
+        for (const std::pair<uint32_t, uint32_t> &match : reconciled.surviving) {
+            uint32_t slot = order[match.first];
+            sampler.sample(&slots[slot], sources[match.second]);
+            next_order.push_back(slot);
+        }
+        for (uint32_t i : reconciled.added) {
+            uint32_t slot = allocate_slot();
+            slot_keys[slot] = current[i];
+            sampler.init(&slots[slot], sources[i]);
+            sampler.sample(&slots[slot], sources[i]);
+            next_order.push_back(slot);
+        }
+        order.swap(next_order);
+        // Keys are from the previous rows
+        keyed.clear();
+        sorted = 0;
+    }
+
+    // Order the first count rows of the display order by key(row), largest
+    // first. The rest follow in no particular order. Only a compact
+    // (key, slot) array is sorted, rows stay in their slots.
+    template<typename KeyFn>
+    void sort_top(const size_t count, KeyFn key) {
+        if (lock)
+            return;
+        STAT_TIMER(PHASE_SORT);
+        keyed.clear();
+        for (uint32_t slot : order)
+            keyed.push_back({key(slots[slot]), slot});
+        sorted = 0;
+        sort_more(count);
+    }
+    // Extend the ordered part to count rows with the keys of the last
+    // sort_top(), for scrolling past it before the next one
+    void sort_more(const size_t count) {
+        if (lock || count <= sorted || keyed.size() != order.size())
+            return;
+        STAT_TIMER(PHASE_SORT);
+        size_t end = std::min(count, keyed.size());
+        std::partial_sort(keyed.begin() + sorted, keyed.begin() + end, keyed.end(),
+            [](const std::pair<double, uint32_t> &a, const std::pair<double, uint32_t> &b) {
+                return a.first > b.first;
+            });
+        for (size_t i = sorted; i < keyed.size(); i++)
+            order[i] = keyed[i].second;
+        sorted = end;
+    }
+
+    // Number of live rows
+    size_t size() const {
+        return order.size();
+    }
+    bool empty() const {
+        return order.empty();
+    }
+    // Row at position pos of the display order
+    Row &at(size_t pos) {
+        return slots[order.at(pos)];
+    }
+    const Row &at(size_t pos) const {
+        return slots[order.at(pos)];
+    }
+    Sampler &get_sampler() {
+        return sampler;
+    }
+private:
+    uint32_t allocate_slot() {
+        if (free_slots.empty()) {
+            slots.emplace_back();
+            slot_keys.emplace_back();
+            return slots.size() - 1;
+        }
+
+        uint32_t slot = free_slots.back();
+        free_slots.pop_back();
+        slots[slot] = Row();
+        return slot;
+    }
+private:
+    Sampler sampler;
+
+    // Slot arena, indexed by slot
+    std::vector<Row> slots;
+    std::vector<struct pid_key> slot_keys;
+    std::vector<uint32_t> free_slots;
+    // Live slots in display order
+    std::vector<uint32_t> order;
+
+    // Scratch buffers, kept to reuse their capacity
+    PidReconciler reconciler;
+    struct reconcile_result reconciled;
+    std::vector<struct pid_key> previous;
+    std::vector<struct pid_key> current;
+    std::vector<uint32_t> next_order;
+    // Sort keys and slots of the last sort_top(), ordered up to sorted
+    std::vector<std::pair<double, uint32_t>> keyed;
+    size_t sorted = 0;
+};
+
+// Base for samplers that build rows straight from the shared snapshot
+struct snapshot_sampler {
+    typedef struct process_sample source;
+
+    snapshot_sampler(const ProcessSnapshot *snapshot = nullptr) : snapshot(snapshot) {};
+
+    struct pid_key key(const source &src) const {
+        return {src.process.pid, src.process.starttime};
+    }
+    template<typename Row>
+    void init(Row *row, const source &src) {
+        row->process = src.process;
+    }
+
+    const ProcessSnapshot *snapshot;
+};
+
+#endif // PROCESS_TABLE_HPP_
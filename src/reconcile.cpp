@@ -0,0 +1,79 @@
+#include "reconcile.hpp"
+
+static inline uint64_t hash_key(const struct pid_key &key) {
+	// splitmix64 finalizer over both fields
+	uint64_t h = key.pid * 0x9E3779B97F4A7C15ULL ^ key.starttime;
+	h ^= h >> 30;
+	h *= 0xBF58476D1CE4E5B9ULL;
+	h ^= h >> 27;
+	h *= 0x94D049BB133111EBULL;
+	h ^= h >> 31;
+	return h;
+}
+
+size_t PidIndex::probe(const struct pid_key &key) const {
+	size_t pos = hash_key(key) & mask;
+	while (entries[pos].used && !(entries[pos].key == key))
+		pos = (pos + 1) & mask;
+	return pos;
+}
+
+void PidIndex::build(const std::vector<struct pid_key> &keys) {
+	// Keep the load factor under 0.5 so probe chains stay short
+	size_t capacity = 16;
+	while (capacity < keys.size() * 2)
+		capacity <<= 1;
+
+	if (entries.size() != capacity)
+		entries.resize(capacity);
+	for (struct entry &e : entries)
+		e = {};
+	mask = capacity - 1;
+	next.assign(keys.size(), -1);
+
+	// Insert backwards so chains hand out indices in their original order
+	for (int64_t i = (int64_t)keys.size() - 1; i >= 0; i--) {
+		struct entry &e = entries[probe(keys[i])];
+		if (e.used)
+			next[i] = e.head;
+		e.key = keys[i];
+		e.head = i;
+		e.used = true;
+	}
+}
+
+int64_t PidIndex::claim(const struct pid_key &key) {
+	struct entry &e = entries[probe(key)];
+	if (!e.used || e.head == -1)
+		return -1;
+
+	int64_t index = e.head;
+	e.head = next[index];
+	return index;
+}
+
+void PidReconciler::reconcile(const std::vector<struct pid_key> &previous,
+							  const std::vector<struct pid_key> &current,
+							  struct reconcile_result *result) {
+	result->added.clear();
+	result->removed.clear();
+	result->surviving.clear();
+
+	index.build(current);
+	claimed.assign(current.size(), false);
+
+	// Walk the previous keys so survivors keep their previous order
+	for (uint32_t i = 0; i < previous.size(); i++) {
+		int64_t cur = index.claim(previous[i]);
+		if (cur == -1) {
+			result->removed.push_back(i);
+			continue;
+		}
+		claimed[cur] = true;
+		result->surviving.push_back({i, (uint32_t)cur});
+	}
+
+	for (uint32_t i = 0; i < current.size(); i++)
+		if (!claimed[i])
+			result->added.push_back(i);
+}
@@ -0,0 +1,69 @@
+#ifndef RECONCILE_HPP_
+#define RECONCILE_HPP_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Identifies a process across ticks. The start time tells apart reused pids.
+struct pid_key {
+	uint64_t pid = 0;
+	// Start time after system boot, in clock ticks
+	uint64_t starttime = 0;
+
+	bool operator==(const struct pid_key &other) const {
+		return pid == other.pid && starttime == other.starttime;
+	}
+};
+
+struct reconcile_result {
+	// Indices into the current keys that weren't present before
+	std::vector<uint32_t> added;
+	// Indices into the previous keys that are no longer present
+	std::vector<uint32_t> removed;
+	// Pairs of (previous index, current index) present in both, in previous order
+	std::vector<std::pair<uint32_t, uint32_t>> surviving;
+};
+
+// Open addressing (linear probing) hash table from pid_key to an index.
+// Equal keys are chained, so every lookup hands out a different index.
+class PidIndex {
+public:
+	PidIndex() {};
+	~PidIndex() {};
+
+	// Drop all keys and index the given ones
+	void build(const std::vector<struct pid_key> &keys);
+	// Index of an unclaimed key equal to key, -1 if there is none
+	int64_t claim(const struct pid_key &key);
+private:
+	struct entry {
+		struct pid_key key = {};
+		// First unclaimed index with this key, -1 once all are claimed
+		int64_t head = -1;
+		bool used = false;
+	};
+
+	size_t probe(const struct pid_key &key) const;
+
+	std::vector<struct entry> entries;
+	// Next index with the same key, -1 at the end of the chain
+	std::vector<int64_t> next;
+	size_t mask = 0;
+};
+
+// Matches old and new pids in linear time
+class PidReconciler {
+public:
+	PidReconciler() {};
+	~PidReconciler() {};
+
+	void reconcile(const std::vector<struct pid_key> &previous,
+				   const std::vector<struct pid_key> &current,
+				   struct reconcile_result *result);
+private:
+	PidIndex index;
+	std::vector<bool> claimed;
+};
+
+#endif // RECONCILE_HPP_
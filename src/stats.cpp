@@ -0,0 +1,54 @@
+#include "stats.hpp"
+
+#ifdef GLIMPSE_STATS
+
+#include <cstdlib> // malloc(), free()
+#include <new>
+
+std::atomic<uint64_t> stat_phase_ns[PHASE_COUNT];
+std::atomic<uint64_t> stat_syscalls;
+std::atomic<uint64_t> stat_bytes_read;
+static std::atomic<uint64_t> stat_allocations;
+
+thread_local ScopedTimer *ScopedTimer::current = nullptr;
+
+// Every container and string of glimpse goes through these, counting them
+// costs one relaxed add
+void *operator new(size_t size) {
+	stat_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void *p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+	free(p);
+}
+
+bool stats_enabled() {
+	return true;
+}
+
+void read_stats(struct cost_sample *sample) {
+	for (int i = 0; i < PHASE_COUNT; i++)
+		sample->phase_ns[i] = stat_phase_ns[i].load(std::memory_order_relaxed);
+	sample->syscalls = stat_syscalls.load(std::memory_order_relaxed);
+	sample->bytes_read = stat_bytes_read.load(std::memory_order_relaxed);
+	sample->allocations = stat_allocations.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool stats_enabled() {
+	return false;
+}
+
+void read_stats(struct cost_sample *sample) {
+	*sample = {};
+}
+
+#endif // GLIMPSE_STATS
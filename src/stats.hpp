@@ -0,0 +1,95 @@
+#ifndef STATS_HPP_
+#define STATS_HPP_
+
+#include <cstdint>
+#include <cstddef>
+
+// Where the time of a tick goes
+enum stat_phase {
+	// Listing the pids
+	PHASE_SCAN,
+	// Reading /proc/{pid}/* and turning it into metrics
+	PHASE_READ,
+	// Ordering the process tables
+	PHASE_SORT,
+	// System wide files, /proc/stat, /sys and such
+	PHASE_SYS,
+	// Filling the windows and writing them out
+	PHASE_RENDER,
+	PHASE_COUNT,
+};
+
+// Running totals since startup, the overlay shows the difference of two
+struct cost_sample {
+	uint64_t phase_ns[PHASE_COUNT] = {};
+	uint64_t syscalls = 0;
+	// Read from procfs and sysfs
+	uint64_t bytes_read = 0;
+	// Calls to operator new
+	uint64_t allocations = 0;
+};
+
+// False if glimpse was built without GLIMPSE_STATS, only the totals kept
+// by the kernel can be shown then
+bool stats_enabled();
+void read_stats(struct cost_sample *sample);
+
+#ifdef GLIMPSE_STATS
+
+#include <atomic>
+#include <ctime>
+
+extern std::atomic<uint64_t> stat_phase_ns[PHASE_COUNT];
+extern std::atomic<uint64_t> stat_syscalls;
+extern std::atomic<uint64_t> stat_bytes_read;
+
+/* Adds the time until it goes out of scope to a phase. Timers nest on a
+ * thread, the time of an inner one is taken off the outer one so every
+ * nanosecond lands in a single phase.
+ */
+class ScopedTimer {
+public:
+	ScopedTimer(const enum stat_phase phase) : phase(phase), outer(current) {
+		current = this;
+		start = now();
+	}
+	~ScopedTimer() {
+		uint64_t elapsed = now() - start;
+		current = outer;
+		if (outer)
+			outer->inner_ns += elapsed;
+		stat_phase_ns[phase].fetch_add(elapsed - inner_ns, std::memory_order_relaxed);
+	}
+	ScopedTimer(const ScopedTimer &) = delete;
+	ScopedTimer &operator=(const ScopedTimer &) = delete;
+private:
+	static uint64_t now() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+	}
+
+	static thread_local ScopedTimer *current;
+	enum stat_phase phase;
+	ScopedTimer *outer;
+	uint64_t start = 0;
+	// Spent in timers nested in this one
+	uint64_t inner_ns = 0;
+};
+
+#define STAT_CONCAT_(a, b)	a##b
+#define STAT_CONCAT(a, b)	STAT_CONCAT_(a, b)
+// Time the rest of the enclosing scope
+#define STAT_TIMER(phase)	ScopedTimer STAT_CONCAT(stat_timer_, __LINE__)(phase)
+#define STAT_SYSCALLS(n)	stat_syscalls.fetch_add((n), std::memory_order_relaxed)
+#define STAT_BYTES_READ(n)	stat_bytes_read.fetch_add((n), std::memory_order_relaxed)
+
+#else
+
+#define STAT_TIMER(phase)	do {} while (0)
+#define STAT_SYSCALLS(n)	do {} while (0)
+#define STAT_BYTES_READ(n)	do {} while (0)
+
+#endif // GLIMPSE_STATS
+
+#endif // STATS_HPP_
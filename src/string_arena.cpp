@@ -0,0 +1,73 @@
+#include "string_arena.hpp"
+
+#include <algorithm> // std::max
+
+StringArena::StringArena() {
+	intern("");
+}
+
+uint32_t StringArena::intern(const std::string_view str) {
+	auto it = index.find(str);
+	if (it != index.end()) {
+		touch(it->second);
+		return it->second;
+	}
+
+	// Appending within the capacity keeps the views in index valid
+	if (storage.size() + str.size() + 1 > storage.capacity())
+		compact(str.size() + 1);
+	uint32_t offset = storage.size();
+	storage.insert(storage.end(), str.begin(), str.end());
+	storage.push_back('\0');
+
+	uint32_t handle;
+	if (free_entries.empty()) {
+		handle = entries.size();
+		entries.emplace_back();
+	} else {
+		handle = free_entries.back();
+		free_entries.pop_back();
+	}
+	struct entry &e = entries[handle];
+	e.offset = offset;
+	e.length = str.size();
+	e.generation = generation;
+	e.live = true;
+	index.emplace(view(handle), handle);
+	live_bytes += str.size() + 1;
+	return handle;
+}
+
+void StringArena::sweep() {
+	for (uint32_t handle = EMPTY + 1; handle < entries.size(); handle++) {
+		struct entry &e = entries[handle];
+		if (!e.live || e.generation == generation)
+			continue;
+		index.erase(view(handle));
+		e.live = false;
+		free_entries.push_back(handle);
+		live_bytes -= e.length + 1;
+		dead_bytes += e.length + 1;
+	}
+	if (dead_bytes > live_bytes)
+		compact(0);
+	generation++;
+}
+
+void StringArena::compact(const size_t extra) {
+	std::vector<char> fresh;
+	fresh.reserve(std::max<size_t>(4096, 2 * (live_bytes + extra)));
+	index.clear();
+	for (uint32_t handle = 0; handle < entries.size(); handle++) {
+		struct entry &e = entries[handle];
+		if (!e.live)
+			continue;
+		const char *str = &storage[e.offset];
+		e.offset = fresh.size();
+		fresh.insert(fresh.end(), str, str + e.length + 1);
+		index.emplace(std::string_view(&fresh[e.offset], e.length), handle);
+	}
+	// Swapping hands over the buffer itself, the views stay valid
+	storage.swap(fresh);
+	dead_bytes = 0;
+}
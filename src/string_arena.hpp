@@ -0,0 +1,74 @@
+#ifndef STRING_ARENA_HPP_
+#define STRING_ARENA_HPP_
+
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+/* Interned strings behind 32-bit handles. Equal strings share one handle,
+ * so a few hundred workers with the same command line cost one copy.
+ * Strings are kept NUL terminated back to back in one buffer.
+ *
+ * Strings live by generation: everything not interned or touched since the
+ * last sweep() is dropped by it. Their bytes are given back in bulk, by
+ * copying the live strings into a fresh buffer once the dead ones take up
+ * more room than the live ones. Handles stay the same across that, but
+ * pointers from c_str() don't survive the next intern() or sweep().
+ * Not thread safe.
+ */
+class StringArena {
+public:
+	StringArena();
+	~StringArena() {};
+
+	// Handle of the empty string, never swept
+	static constexpr uint32_t EMPTY = 0;
+
+	// Handle of str, added if it isn't in the arena yet
+	uint32_t intern(const std::string_view str);
+	// Keep handle alive through the next sweep()
+	void touch(const uint32_t handle) {
+		entries[handle].generation = generation;
+	}
+	const char *c_str(const uint32_t handle) const {
+		return &storage[entries[handle].offset];
+	}
+	std::string_view view(const uint32_t handle) const {
+		return std::string_view(c_str(handle), entries[handle].length);
+	}
+	// Drop the strings that weren't interned or touched since the last sweep
+	void sweep();
+
+	// Number of live strings
+	size_t size() const {
+		return index.size();
+	}
+	// Bytes held by the string buffer
+	size_t capacity() const {
+		return storage.capacity();
+	}
+private:
+	struct entry {
+		uint32_t offset = 0;
+		uint32_t length = 0;
+		uint32_t generation = 0;
+		bool live = false;
+	};
+
+	// Copy the live strings into a buffer with room for extra more bytes
+	void compact(const size_t extra);
+
+	std::vector<char> storage;
+	// Indexed by handle
+	std::vector<struct entry> entries;
+	std::vector<uint32_t> free_entries;
+	// Views into storage, rebuilt whenever it moves
+	std::unordered_map<std::string_view, uint32_t> index;
+
+	uint32_t generation = 0;
+	size_t live_bytes = 0;
+	size_t dead_bytes = 0;
+};
+
+#endif // STRING_ARENA_HPP_
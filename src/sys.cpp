@@ -1,4 +1,5 @@
 #include "sys.hpp"
+#include "stats.hpp"
 
 #include <fstream>
 #include <sys/utsname.h>
@@ -36,6 +37,7 @@ void get_product_name(std::string *name) {
 }
 
 void get_non_virtual_block_devices(std::vector<struct disk_device> *devices) {
+	STAT_TIMER(PHASE_SYS);
 	DIR *dir;
 	struct dirent *file;
 
@@ -68,6 +70,7 @@ void get_non_virtual_block_devices(std::vector<struct disk_device> *devices) {
 }
 
 void get_non_virtual_network_devices(std::vector<struct net_device> *devices) {
+	STAT_TIMER(PHASE_SYS);
 	DIR *dir;
 	struct dirent *file;
     constexpr int size = 1024;
@@ -213,6 +216,7 @@ void get_sys_pci_device_driver(const std::string id, std::string *driver) {
 }
 
 void get_sys_dri_clients(const std::string id, std::vector<struct dri_client> *clients) {
+	STAT_TIMER(PHASE_SYS);
 	std::string filepath(std::string("/sys/kernel/debug/dri/") + id + "/clients");
     std::ifstream infile(filepath);
     if (!infile.is_open())
@@ -346,6 +350,7 @@ void get_sys_drm_freq(const std::string id, uint32_t *freq) {
 }
 
 void get_sys_freq(const std::string id, uint32_t *freq) {
+	STAT_TIMER(PHASE_SYS);
     get_sys_dri_freq(id, freq);
     if (*freq == 0)
         get_sys_drm_freq(id, freq);
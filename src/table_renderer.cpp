@@ -0,0 +1,78 @@
+#include "table_renderer.hpp"
+
+#include <algorithm> // std::min
+
+void TableRenderer::set_layout(WINDOW *window, const std::vector<int> &offsets, const std::vector<int> &widths) {
+	this->window = window;
+	this->offsets = offsets;
+	this->widths = widths;
+	invalidate();
+}
+
+void TableRenderer::resize(const uint32_t start, const uint32_t rows) {
+	if (start == this->start && rows == this->rows)
+		return;
+	this->start = start;
+	this->rows = rows;
+	invalidate();
+}
+
+void TableRenderer::invalidate() {
+	if (!window)
+		return;
+	cells.assign(rows * offsets.size(), std::string());
+	selected = NO_ROW;
+	// Nothing is cached, whatever was there before has to go
+	for (uint32_t row = 0; row < rows; row++) {
+		wmove(window, start + row, 0);
+		wclrtoeol(window);
+	}
+}
+
+void TableRenderer::clear_row(const uint32_t row) {
+	for (uint32_t column = 0; column < offsets.size(); column++)
+		cell(row, column, "");
+}
+
+void TableRenderer::select(const uint32_t row) {
+	if (!window || row == selected)
+		return;
+	if (selected < rows)
+		mvwchgat(window, start + selected, 0, -1, A_NORMAL, 0, NULL);
+	if (row < rows)
+		mvwchgat(window, start + row, 0, -1, A_REVERSE, 0, NULL);
+	selected = row;
+}
+
+void TableRenderer::cell(const uint32_t row, const uint32_t column, std::string_view text,
+						 const enum column_align align) {
+	if (!window || row >= rows || column >= offsets.size())
+		return;
+	size_t room = width(column);
+	if (text.size() > room)
+		text = text.substr(0, room);
+	if (align == ALIGN_RIGHT && text.size() < room) {
+		padded.assign(room - text.size(), ' ');
+		padded.append(text);
+		text = padded;
+	}
+	std::string &shown = cells[row * offsets.size() + column];
+	if (shown == text)
+		return;
+
+	// Keep the highlight of the selected row
+	if (row == selected)
+		wattron(window, A_REVERSE);
+	mvwaddnstr(window, start + row, offsets[column], text.data(), text.size());
+	// Blank the rest of a longer text drawn before
+	for (size_t i = text.size(); i < shown.size(); i++)
+		waddch(window, ' ');
+	if (row == selected)
+		wattroff(window, A_REVERSE);
+	shown.assign(text);
+}
+
+size_t TableRenderer::width(const uint32_t column) const {
+	int end = std::min(offsets[column] + widths[column], getmaxx(window));
+	return end > offsets[column] ? end - offsets[column] : 0;
+}
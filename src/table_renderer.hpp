@@ -0,0 +1,63 @@
+#ifndef TABLE_RENDERER_HPP_
+#define TABLE_RENDERER_HPP_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+extern "C" {
+	#include <ncurses.h> //GUI
+}
+
+enum column_align {
+	ALIGN_LEFT,
+	ALIGN_RIGHT,
+};
+
+/* Draws the process table of a tab cell by cell, keeping the text of every
+ * cell that is on screen. A cell is only written to the window when its
+ * text changed, so a steady table costs no terminal output and a changing
+ * one only the cells that moved.
+ * Cells are cut off at their column's width, they never spill into their
+ * neighbours. Nothing else may draw over the table rows, or the cache no
+ * longer matches the window.
+ */
+class TableRenderer {
+public:
+	TableRenderer() {};
+	~TableRenderer() {};
+
+	// Draw into window, columns at offsets and as wide as widths
+	void set_layout(WINDOW *window, const std::vector<int> &offsets, const std::vector<int> &widths);
+	// Table rows are window rows start to start+rows-1, a change clears them
+	void resize(const uint32_t start, const uint32_t rows);
+	// Forget the cached cells and clear the table rows
+	void invalidate();
+
+	// Set the text of a cell, drawn if it differs from what's on screen
+	void cell(const uint32_t row, const uint32_t column, std::string_view text,
+			  const enum column_align align = ALIGN_LEFT);
+	// Blank every cell of row, past the end of the table
+	void clear_row(const uint32_t row);
+	// Highlight row, taking the highlight off the one selected before
+	void select(const uint32_t row);
+private:
+	// Characters that fit in column
+	size_t width(const uint32_t column) const;
+
+	static constexpr uint32_t NO_ROW = UINT32_MAX;
+
+	WINDOW *window = nullptr;
+	std::vector<int> offsets;
+	std::vector<int> widths;
+	uint32_t start = 0;
+	uint32_t rows = 0;
+	uint32_t selected = NO_ROW;
+	// Text on screen, row by row
+	std::vector<std::string> cells;
+	// Right aligned text
+	std::string padded;
+};
+
+#endif // TABLE_RENDERER_HPP_
@@ -0,0 +1,48 @@
+#include "table_spec.hpp"
+
+#include <algorithm> // std::min
+
+void TableLayout::layout(const int width) {
+	visible.clear();
+	for (uint32_t i = 0; i < sizes.size(); i++)
+		visible.push_back(i);
+
+	auto needed = [this] {
+		int total = visible.empty() ? 0 : visible.size() - 1;
+		for (uint32_t i : visible)
+			total += sizes[i].min_width;
+		return total;
+	};
+	while (needed() > width) {
+		// The least important column that can go
+		auto drop = visible.end();
+		for (auto it = visible.begin(); it != visible.end(); ++it)
+			if (sizes[*it].priority && (drop == visible.end() || sizes[*it].priority >= sizes[*drop].priority))
+				drop = it;
+		if (drop == visible.end())
+			break;
+		visible.erase(drop);
+	}
+
+	int left = std::max(width - needed(), 0);
+	widths.assign(visible.size(), 0);
+	for (uint32_t c = 0; c < visible.size(); c++) {
+		const struct column_size &size = sizes[visible[c]];
+		widths[c] = size.min_width;
+		if (size.max_width > size.min_width) {
+			int grow = std::min(left, size.max_width - size.min_width);
+			widths[c] += grow;
+			left -= grow;
+		}
+	}
+	for (uint32_t c = 0; c < visible.size(); c++) {
+		if (!sizes[visible[c]].max_width) {
+			widths[c] += left;
+			break;
+		}
+	}
+
+	offsets.assign(visible.size(), 0);
+	for (uint32_t c = 1; c < visible.size(); c++)
+		offsets[c] = offsets[c - 1] + widths[c - 1] + 1;
+}
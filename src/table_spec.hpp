@@ -0,0 +1,99 @@
+#ifndef TABLE_SPEC_HPP_
+#define TABLE_SPEC_HPP_
+
+#include "table_renderer.hpp"
+
+#include <functional>
+#include <string>
+#include <algorithm> // std::min
+#include <string_view>
+#include <vector>
+#include <utility> // std::move
+#include <cstdint>
+
+// How much room a column wants, independent of what it shows
+struct column_size {
+	uint16_t min_width = 0;
+	// 0 takes whatever width is left
+	uint16_t max_width = 0;
+	// Higher ones are hidden first when the terminal is too narrow, 0 never is
+	uint8_t priority = 0;
+};
+
+/* Picks the columns that fit a width and places them, once per resize.
+ * Columns are hidden highest priority first until the min_width of the
+ * rest fits. What's left over widens them up to their max_width, left to
+ * right, and the first column without a max_width takes the remainder.
+ * Columns are a space apart.
+ */
+class TableLayout {
+public:
+	virtual ~TableLayout() {};
+
+	void layout(const int width);
+
+	// x and width of every visible column, left to right
+	const std::vector<int> &get_offsets() const {
+		return offsets;
+	}
+	const std::vector<int> &get_widths() const {
+		return widths;
+	}
+protected:
+	std::vector<struct column_size> sizes;
+	// Index into sizes of every visible column
+	std::vector<uint32_t> visible;
+	std::vector<int> offsets;
+	std::vector<int> widths;
+};
+
+template<typename Row>
+struct table_column {
+	// Names the column, like the header of a csv
+	std::string_view id = {};
+	struct column_size size = {};
+	enum column_align align = ALIGN_LEFT;
+	// Text of the cell for row, snprintf() style
+	std::function<int(const Row &row, char *buf, size_t size)> format;
+};
+
+// Columns of a process table, formatted only for the rows that are drawn
+template<typename Row>
+class TableSpec : public TableLayout {
+public:
+	TableSpec() {};
+	TableSpec(std::vector<struct table_column<Row>> columns) : columns(std::move(columns)) {
+		for (const struct table_column<Row> &column : this->columns)
+			sizes.push_back(column.size);
+	}
+
+	// Format the visible columns of row into table row i
+	void draw_row(TableRenderer *renderer, const uint32_t i, const Row &row) {
+		for (uint32_t c = 0; c < visible.size(); c++)
+			renderer->cell(i, c, format(row, visible[c]), columns[visible[c]].align);
+	}
+	// Whole text of column c of row, hidden or not. Only valid until the next call.
+	std::string_view format(const Row &row, const uint32_t c) {
+		int len = columns[c].format(row, &buffer[0], buffer.size());
+		if (len < 0)
+			return std::string_view();
+		// Didn't fit, grow to what it needs and format again
+		if ((size_t)len >= buffer.size()) {
+			buffer.resize(len + 1);
+			len = columns[c].format(row, &buffer[0], buffer.size());
+			if (len < 0)
+				return std::string_view();
+		}
+		return std::string_view(buffer.data(), std::min((size_t)len, buffer.size() - 1));
+	}
+
+	const std::vector<struct table_column<Row>> &get_columns() const {
+		return columns;
+	}
+private:
+	std::vector<struct table_column<Row>> columns;
+	// Grows to the longest cell formatted so far
+	std::string buffer = std::string(1024, '\0');
+};
+
+#endif // TABLE_SPEC_HPP_
@@ -11,17 +11,18 @@
 #include <string>
 #include <iomanip> // put_time
 
-#define COLUMN_1    0
-#define COLUMN_2    COLUMN_1+8
-#define COLUMN_3    COLUMN_2+30
-#define COLUMN_4    COLUMN_3+8
-#define COLUMN_5    COLUMN_4+13
+// Per-core grid cell: "id[bar] "
+#define CORE_BAR_WIDTH  10
+#define CORE_CELL_WIDTH (3+1+CORE_BAR_WIDTH+1+1)
+// Info rows above the core grid
+#define CORE_GRID_ROW   6
 
 uint64_t CPU::get_pid_at_pos() {
     return processes.at(proc_table_pos).process.pid;
 }
 
 void get_temps(std::vector<double> *temps) {
+	STAT_TIMER(PHASE_SYS);
 	DIR *dir;
 	struct dirent *file;
     FILE *fp_type;
@@ -76,132 +77,136 @@ void get_temps(std::vector<double> *temps) {
 	closedir(dir);
 }
 
-void CPU::update_cpu_process(struct cpu_process *proc) {
-    uint64_t previous_cpu_uptime = proc->cpu_uptime;
-    struct pid_stat previous_pid_stats = proc->stats;
+void cpu_sampler::sample(struct cpu_process *proc, const source &src) {
+    const struct process_metrics &metrics = snapshot->get_process_metrics();
 
-    read_pid_stat(proc->process.pid, &proc->stats);
-
-    // Convert from ticks to seconds
-    proc->stats.starttime = proc->stats.starttime / ticks_per_s;
-    proc->uptime = system_uptime - proc->stats.starttime;
+    proc->uptime = snapshot->get_pid_uptime(&src);
+    proc->usage_percent = metrics.cpu_usage[snapshot->index_of(&src)];
+}
 
-    get_uptime(&proc->cpu_uptime);
+void CPU::find_cpu_processes() {
+    system_uptime = snapshot->get_uptime();
 
-    double cpu_time_delta = (proc->cpu_uptime - previous_cpu_uptime);
-    double proc_stat_times = proc->stats.utime + proc->stats.stime +
-                               proc->stats.cutime + proc->stats.cstime;
-    double previous_stat_times = previous_pid_stats.utime + previous_pid_stats.stime +
-                                   previous_pid_stats.cutime + previous_pid_stats.cstime;
-    double proc_time_delta = static_cast<double>((proc_stat_times - previous_stat_times)) / ticks_per_s;
-    double usage = static_cast<double>(proc_time_delta / cpu_time_delta) * 100;
-    // If really quick refresh happens protect against divide by 0
-    proc->usage_percent = cpu_time_delta ? usage : 0;
+    processes.update(snapshot->get_processes());
 }
 
-void CPU::find_cpu_processes() {
-	// Reset is_alive for all processes
-	for (struct cpu_process &p : processes)
-			p.process.is_alive = false;
-
-    // Get currently active processes
-    std::vector<struct process> proc_vec;
-    find_processes(&proc_vec);
-
-    // Check if processes are new or already in vector
-    struct process proc;
-	for (struct cpu_process &cpuproc : processes) {
-        for (int j = 0; j < (int)proc_vec.size(); j++) {
-            proc = proc_vec.at(j);
-            if (cpuproc.process.pid == proc.pid) {
-                // Found
-                cpuproc.process.is_alive = true;
-                std::vector<struct process>::iterator it = (proc_vec.begin() + j);
-                proc_vec.erase(it);
-                break;
-            }
-        }
+uint32_t CPU::draw_core_grid(const uint32_t row) {
+    const struct cpu_core_stats &current = core_stats[current_core_stats];
+
+    uint32_t columns = std::max(1, getmaxx(tab_window) / CORE_CELL_WIDTH);
+    uint32_t rows = (current.size() + columns - 1) / columns;
+    // Leave the process table at least a row, a last one tells how many
+    // cores didn't fit
+    int height = getmaxy(tab_window);
+    uint32_t room = height > (int)row + 1 ? height - row - 1 : 0;
+    uint32_t shown = current.size();
+    if (rows > room) {
+        rows = room;
+        shown = room ? (room - 1) * columns : 0;
     }
-
-    // All processes that haven't been found and removed should be added to processes vector
-	for (struct process &p : proc_vec) {
-        struct cpu_process cp = {0};
-        cp.process = p;
-        processes.push_back(cp);
+    char bar[CORE_BAR_WIDTH+1];
+    for (uint32_t i = 0; i < shown; i++) {
+        // Round each part separately, the bar is only an estimate anyway
+        int user = core_usage.user[i] * CORE_BAR_WIDTH + 0.5;
+        int system = core_usage.system[i] * CORE_BAR_WIDTH + 0.5;
+        int iowait = core_usage.iowait[i] * CORE_BAR_WIDTH + 0.5;
+        int steal = core_usage.steal[i] * CORE_BAR_WIDTH + 0.5;
+        int pos = 0;
+        for (int j = 0; j < user && pos < CORE_BAR_WIDTH; j++)
+            bar[pos++] = '|';
+        for (int j = 0; j < system && pos < CORE_BAR_WIDTH; j++)
+            bar[pos++] = '+';
+        for (int j = 0; j < iowait && pos < CORE_BAR_WIDTH; j++)
+            bar[pos++] = 'w';
+        for (int j = 0; j < steal && pos < CORE_BAR_WIDTH; j++)
+            bar[pos++] = 's';
+        while (pos < CORE_BAR_WIDTH)
+            bar[pos++] = ' ';
+        bar[pos] = '\0';
+
+        mvwprintw(tab_window, row + i / columns, (i % columns) * CORE_CELL_WIDTH,
+                  "%3u[%s]", current.id[i], bar);
     }
+    if (shown < current.size() && rows) {
+        mvwprintw(tab_window, row + rows - 1, 0, "+%lu cores", current.size() - shown);
+        wclrtoeol(tab_window);
+    }
+    return rows;
+}
 
-    // Clear dead processes
-    erase_from_vector<struct cpu_process>(&processes, [](struct cpu_process p) {
-			return (!p.process.is_alive);
-		});
-
-    // Get rest of the fields for cpuproc
-	for (struct cpu_process &cpuproc : processes)
-        CPU::update_cpu_process(&cpuproc);
+CPU::CPU(const ProcessSnapshot *snapshot, CmdlineCache *cmdlines) : Tab(snapshot, cmdlines), processes(cpu_sampler(snapshot)) {
+    // First read, so the first update already has something to compare to
+    read_cpu_core_stats(&core_stats[current_core_stats]);
+    columns = TableSpec<struct cpu_process>({
+        pid_column<struct cpu_process>(),
+        name_column<struct cpu_process>(),
+        {"cpu", {6, 6, 0}, ALIGN_RIGHT, [](const struct cpu_process &p, char *buf, size_t size) {
+            return snprintf(buf, size, "%.2f", p.usage_percent);
+        }},
+        uptime_column<struct cpu_process>(),
+        command_column<struct cpu_process>(),
+    });
+    set_table_spec(&columns);
+    set_info_block_size(CORE_GRID_ROW);
 }
 
-CPU::CPU() {
-    // Need to have some time between sampling, if it's too close samples are basically 0
-	wtimeout(tab_window, 1000);
-    set_info_block_size(5);
+uint32_t CPU::get_metrics() const {
+    return METRIC_STAT;
+}
 
-    ticks_per_s = sysconf(_SC_CLK_TCK);
+void CPU::collect() {
+	STAT_TIMER(PHASE_READ);
+	find_cpu_processes();
+    processes.sort_top(sort_window(), [](const struct cpu_process &p) {
+        return p.usage_percent;
+    });
+
+    // Swap buffers so the previous read is kept for the delta
+    const struct cpu_core_stats &previous = core_stats[current_core_stats];
+    current_core_stats ^= 1;
+    read_cpu_core_stats(&core_stats[current_core_stats]);
+    cpu_core_delta(previous, core_stats[current_core_stats], &core_usage);
+
+    // Info, read here so redraws on keypresses don't go to /proc and /sys
+    cores.clear();
+    read_cpuinfo(&cores);
+    temps.clear();
+    get_temps(&temps);
+}
 
-    update();
+void CPU::write_batch(BatchWriter *out) {
+    write_table(out, "cpu", &processes, &columns);
 }
 
 void CPU::update() {
-	find_cpu_processes();
-    sort_vector<struct cpu_process>(&processes,
-        [](const struct cpu_process p1, const struct cpu_process p2) {
-            return p1.usage_percent > p2.usage_percent;
-        });
     process_vector_size = processes.size();
 
     // Info
-    std::vector<struct cpuinfo_core> cores;
-    read_cpuinfo(&cores);
-    mvwprintw(tab_window, info_block_start, 0, "Model: %s", cores[0].model_name.c_str());
-    uint8_t num_sockets = cores.back().physical_id + 1;
-    mvwprintw(tab_window, info_block_start+1, 0, "Cores/Threads: %u/%lu", cores[0].cpu_cores*num_sockets, cores.size());
-    std::vector<double> temps = {};
-    get_temps(&temps);
+    // /proc/cpuinfo can be unreadable or empty, in a container for one
+    if (!cores.empty()) {
+        mvwprintw(tab_window, info_block_start, 0, "Model: %s", cores[0].model_name.c_str());
+        uint8_t num_sockets = cores.back().physical_id + 1;
+        mvwprintw(tab_window, info_block_start+1, 0, "Cores/Threads: %u/%lu", cores[0].cpu_cores*num_sockets, cores.size());
+    }
     mvwprintw(tab_window, info_block_start+2, 0, "Temp:");
     for (uint32_t i = 0; i < temps.size(); i++) {
         mvwprintw(tab_window, info_block_start+2, 5+i*7, " %.1f°C        ", (double)temps[i]);
-        wrefresh(tab_window);
     }
-    double avg_clock = 0;
-    for (int i = 0; i < (int)cores.size(); i++)
-        avg_clock += cores[i].cpu_MHz;
-    avg_clock /= cores[0].siblings;
-    mvwprintw(tab_window, info_block_start+3, 0, "Avg clock speed: %.2fMHz", (double)avg_clock);
-    // system_uptime get updated through update_cpu_process
-    get_uptime(&system_uptime);
+    if (!cores.empty() && cores[0].siblings) {
+        double avg_clock = 0;
+        for (int i = 0; i < (int)cores.size(); i++)
+            avg_clock += cores[i].cpu_MHz;
+        avg_clock /= cores[0].siblings;
+        mvwprintw(tab_window, info_block_start+3, 0, "Avg clock speed: %.2fMHz", (double)avg_clock);
+    }
+    // system_uptime gets updated through find_cpu_processes
     mvwprintw(tab_window, info_block_start+4, 0, "Uptime: %s", format_time(system_uptime).c_str());
+    mvwprintw(tab_window, info_block_start+5, 0, "Cores: | user  + system  w iowait  s steal");
+    uint32_t grid_rows = draw_core_grid(info_block_start+CORE_GRID_ROW);
+    set_info_block_size(CORE_GRID_ROW + grid_rows);
 
     // Proc
-    uint32_t pos = proc_table_top;
-    struct cpu_process *proc;
-    for (uint32_t i = 0; i <= proc_block_size; i++) {
-        if (pos >= processes.size()) {
-            mvwprintw(tab_window, proc_block_start+i, 0, " ");
-		    wclrtoeol(tab_window);
-            continue;
-        }
-        proc = &processes.at(pos);
-        // CPU::update_cpu_process(proc);
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_1, "%lu", proc->process.pid);
-        /* Clear extra characters if previous value was longer */
-		wclrtoeol(tab_window);
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_2, "%s", proc->process.name.c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_3, "%6.2f", (double)proc->usage_percent);
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_4, "%s", format_time(proc->uptime).c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_5, "%s", proc->process.cmd.c_str());
-        pos++;
-        if (pos >= processes.size())
-            break;
-    }
-    /* Invert the highlight of the currently selected process */
-    mvwchgat(tab_window, proc_block_start+proc_table_pos, 0, -1, A_REVERSE, 0, NULL);
+    // Scrolled past the rows ordered in collect()
+    processes.sort_more(sort_window());
+    draw_table(processes, &columns);
 };
\ No newline at end of file
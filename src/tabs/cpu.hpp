@@ -3,33 +3,47 @@
 
 #include "tab.hpp"
 #include "../proc.hpp"
+#include "../process_table.hpp"
 
 #include <string>
 #include <vector>
 
 struct cpu_process {
 	struct process      process = {0};
-    struct pid_stat     stats = {};
 	double              usage_percent = 0;
     uint64_t            uptime = 0; // in seconds
-    // cpu_uptime when last checked
-    uint64_t            cpu_uptime = 0; // in seconds
+};
+
+struct cpu_sampler : public snapshot_sampler {
+    cpu_sampler(const ProcessSnapshot *snapshot = nullptr) : snapshot_sampler(snapshot) {};
+
+    void sample(struct cpu_process *proc, const source &src);
 };
 
 class CPU : public Tab {
 public:
-    CPU();
+    CPU(const ProcessSnapshot *snapshot, CmdlineCache *cmdlines);
     ~CPU() {};
 
+    uint32_t get_metrics() const override;
+    void collect() override;
     void update() override;
     uint64_t get_pid_at_pos() override;
+    void write_batch(BatchWriter *out) override;
 private:
-    void update_cpu_process(struct cpu_process *proc);
     void find_cpu_processes();
+    // Per-core usage as a grid of bars, returns the number of rows used
+    uint32_t draw_core_grid(const uint32_t row);
 private:
-    std::vector<struct cpu_process> processes;
-    struct cpu_stat cpu_stats;
-    uint16_t ticks_per_s;
+    ProcessTable<struct cpu_process, struct cpu_sampler> processes;
+    TableSpec<struct cpu_process> columns;
+    // Per-core jiffies of the previous and the current update
+    struct cpu_core_stats core_stats[2];
+    uint8_t current_core_stats = 0;
+    struct cpu_core_usage core_usage;
+    // /proc/cpuinfo and hwmon temperatures as of the last collect()
+    std::vector<struct cpuinfo_core> cores;
+    std::vector<double> temps;
     // Start time in seconds since boot
     uint64_t system_uptime;
 };
@@ -4,14 +4,6 @@
 
 #include <memory> // unique_ptr
 
-#define COLUMN_1    0                   // pid
-#define COLUMN_2    COLUMN_1+8          // name
-#define COLUMN_3    COLUMN_2+30         // read_bytes
-#define COLUMN_4    COLUMN_3+8          // write_bytes
-#define COLUMN_5    COLUMN_4+8          // read / s
-#define COLUMN_6    COLUMN_5+11         // write / s
-#define COLUMN_7    COLUMN_6+11         // uptime
-#define COLUMN_8    COLUMN_7+13         // cmd
 
 uint64_t DISK::get_pid_at_pos() {
     return processes.at(proc_table_pos).process.pid;
@@ -85,97 +77,67 @@ void DISK::find_disks() {
 //     }
 // }
 
-void update_disk_process(struct disk_process *proc) {
-    uint64_t old_uptime = proc->uptime;
-    struct pid_io old_io = proc->io;
+void disk_sampler::sample(struct disk_process *proc, const source &src) {
+    const struct process_metrics &metrics = snapshot->get_process_metrics();
+    size_t i = snapshot->index_of(&src);
 
-    get_pid_uptime(proc->process.pid, &proc->uptime);
+    proc->uptime = snapshot->get_pid_uptime(&src);
 
-    struct pid_status status = {};
-    read_pid_status(proc->process.pid, &status);
-    proc->swap = status.VmSwap.empty() ? 0 : std::stoul(status.VmSwap);
-
-    read_pid_io(proc->process.pid, &proc->io);
-
-    uint64_t time_delta = proc->uptime - old_uptime;
-    if (time_delta) {
-        proc->read_per_s = (proc->io.read_bytes - old_io.read_bytes)*1.0 / time_delta;
-        proc->write_per_s = (proc->io.write_bytes - old_io.write_bytes)*1.0 / time_delta;
-    } else {
-        proc->read_per_s = 0;
-        proc->write_per_s = 0;
-    }
+    proc->read_bytes = metrics.read_bytes[i];
+    proc->write_bytes = metrics.write_bytes[i];
+    proc->read_per_s = metrics.read_per_s[i];
+    proc->write_per_s = metrics.write_per_s[i];
 }
 
 void DISK::find_disk_processes() {
-	// Reset is_alive for all processes
-	for (struct disk_process &p : processes)
-			p.process.is_alive = false;
-
-    // Get currently active processes
-    std::vector<struct process> proc_vec;
-    find_processes(&proc_vec);
-
-    // Check if processes are new or already in vector
-    struct process proc;
-	for (struct disk_process &diskproc : processes) {
-        for (int j = 0; j < (int)proc_vec.size(); j++) {
-            proc = proc_vec.at(j);
-            if (diskproc.process.pid == proc.pid) {
-                // Found
-                diskproc.process.is_alive = true;
-                std::vector<struct process>::iterator it = (proc_vec.begin() + j);
-                proc_vec.erase(it);
-                break;
-            }
-        }
-    }
-
-    // All processes that haven't been found and removed should be added to processes vector
-	for (struct process &p : proc_vec) {
-        struct disk_process cp = {0};
-        cp.process = p;
-        processes.push_back(cp);
-    }
+    processes.update(snapshot->get_processes());
+}
 
-    // Clear dead processes
-    erase_from_vector<struct disk_process>(&processes, [](struct disk_process p) {
-			return (!p.process.is_alive);
-		});
+DISK::DISK(const ProcessSnapshot *snapshot, CmdlineCache *cmdlines) : Tab(snapshot, cmdlines), processes(disk_sampler(snapshot)) {
+    columns = TableSpec<struct disk_process>({
+        pid_column<struct disk_process>(),
+        name_column<struct disk_process>(),
+        {"read", {7, 7, 2}, ALIGN_RIGHT, [](const struct disk_process &p, char *buf, size_t size) {
+            return snprintf(buf, size, "%s", format_size(p.read_bytes).c_str());
+        }},
+        {"written", {7, 7, 2}, ALIGN_RIGHT, [](const struct disk_process &p, char *buf, size_t size) {
+            return snprintf(buf, size, "%s", format_size(p.write_bytes).c_str());
+        }},
+        {"read_per_s", {9, 10, 0}, ALIGN_RIGHT, [](const struct disk_process &p, char *buf, size_t size) {
+            return snprintf(buf, size, "%s/s", format_size(p.read_per_s).c_str());
+        }},
+        {"write_per_s", {9, 10, 0}, ALIGN_RIGHT, [](const struct disk_process &p, char *buf, size_t size) {
+            return snprintf(buf, size, "%s/s", format_size(p.write_per_s).c_str());
+        }},
+        uptime_column<struct disk_process>(),
+        command_column<struct disk_process>(),
+    });
+    set_table_spec(&columns);
+};
 
-    // Get rest of the fields
-	for (struct disk_process &proc : processes)
-       update_disk_process(&proc);
+uint32_t DISK::get_metrics() const {
+    return METRIC_IO;
 }
 
-DISK::DISK() {
-    // Need to have some time between sampling, if it's too close samples are basically 0
-	wtimeout(tab_window, 1000);
+void DISK::collect() {
+	STAT_TIMER(PHASE_READ);
+    find_disk_processes();
+    processes.sort_top(sort_window(), [](const struct disk_process &p) {
+        return p.read_per_s + p.write_per_s;
+    });
+    // Disks come and go between snapshots, not between keypresses
+    find_disks();
+}
 
-    update();
-};
+void DISK::write_batch(BatchWriter *out) {
+    write_table(out, "disk", &processes, &columns);
+}
 
 void DISK::update() {
     // Info
-    find_disks();
+    // If a disk was removed the table clears the rows it moves up to
     set_info_block_size(devices.size());
-
-    find_disk_processes();
-    sort_vector<struct disk_process>(&processes,
-        [](const struct disk_process p1, const struct disk_process p2) {
-            return (p1.read_per_s + p1.write_per_s) > (p2.read_per_s + p2.write_per_s);
-        });
-
-    // If a disk was removed extend proc block up
-    uint32_t previous_size = process_vector_size;
     process_vector_size = processes.size();
-    if (process_vector_size != previous_size)
-        for (uint32_t i = 0; i < process_vector_size; i++) {
-            // Move cursor to beginning of row
-            mvcur(getcurx(tab_window), getcury(tab_window), info_block_start+i, 0);
-            // Erase row
-		    wclrtoeol(tab_window);
-        }
 
     for (int i = 0; i < (int)devices.size(); i++) {
         mvwprintw(tab_window, info_block_start+i, 0, "%s:", devices.at(i).id.c_str());
@@ -192,24 +154,7 @@ void DISK::update() {
     }
 
     // Proc
-    uint32_t pos = proc_table_top;
-    struct disk_process *proc;
-    for (uint32_t i = 0; i <= proc_block_size; i++) {
-        proc = &processes.at(pos);
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_1, "%lu", proc->process.pid);
-        /* Clear extra characters if previous value was longer */
-		wclrtoeol(tab_window);
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_2, "%s", proc->process.name.c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_3, "%s", format_size(proc->io.read_bytes).c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_4, "%s", format_size(proc->io.write_bytes).c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_5, "%s/s", format_size(proc->read_per_s).c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_6, "%s/s", format_size(proc->write_per_s).c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_7, "%s", format_time(proc->uptime).c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_8, "%s", proc->process.cmd.c_str());
-        pos++;
-        if (pos >= processes.size())
-            break;
-    }
-    /* Invert the highlight of the currently selected process */
-    mvwchgat(tab_window, proc_block_start+proc_table_pos, 0, -1, A_REVERSE, 0, NULL);
+    // Scrolled past the rows ordered in collect()
+    processes.sort_more(sort_window());
+    draw_table(processes, &columns);
 }
\ No newline at end of file
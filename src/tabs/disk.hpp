@@ -3,30 +3,41 @@
 
 #include "tab.hpp"
 #include "../proc.hpp"
+#include "../process_table.hpp"
 #include "../sys.hpp"
 
 struct disk_process {
 	struct process      process = {0};
     uint64_t            uptime = 0; // in seconds
-    struct pid_io       io = {0};
+    uint64_t            read_bytes = 0;
+    uint64_t            write_bytes = 0;
     double              read_per_s = 0;
     double              write_per_s = 0;
-    uint64_t            swap = 0; // in kB
+};
+
+struct disk_sampler : public snapshot_sampler {
+    disk_sampler(const ProcessSnapshot *snapshot = nullptr) : snapshot_sampler(snapshot) {};
+
+    void sample(struct disk_process *proc, const source &src);
 };
 
 class DISK : public Tab {
 public:
-    DISK();
+    DISK(const ProcessSnapshot *snapshot, CmdlineCache *cmdlines);
     ~DISK() {};
 
+    uint32_t get_metrics() const override;
+    void collect() override;
     void update() override;
     uint64_t get_pid_at_pos() override;
+    void write_batch(BatchWriter *out) override;
 private:
     void find_disks();
     // void get_udevadm_data();
     void find_disk_processes();
 private:
-    std::vector<struct disk_process> processes;
+    ProcessTable<struct disk_process, struct disk_sampler> processes;
+    TableSpec<struct disk_process> columns;
     std::vector<struct disk_device> devices;
 };
 
@@ -3,18 +3,41 @@
 
 #include "tab.hpp"
 #include "../proc.hpp"
+#include "../process_table.hpp"
 
 struct gpu_process {
 	struct process process = {0};
 	double usage_percent = 0;
     uint64_t usage_ns = 0;
-    // system uptime when last checked
-    uint64_t last_checked = 0; // in seconds
+    // CLOCK_MONOTONIC when usage_ns was last read
+    uint64_t last_checked = 0; // in ns
     int32_t vram = -1; // in B
     uint64_t uptime = 0;
     std::string card_num = "";
 };
 
+// Process with an open render node on a card
+struct card_process {
+    struct process proc = {};
+    std::string card = "";
+};
+
+struct gpu_sampler {
+    typedef struct card_process source;
+
+    gpu_sampler(const ProcessSnapshot *snapshot = nullptr) : snapshot(snapshot) {};
+
+    struct pid_key key(const source &src) const {
+        return {src.proc.pid, src.proc.starttime};
+    }
+    void init(struct gpu_process *proc, const source &src) {
+        proc->process = src.proc;
+    }
+    void sample(struct gpu_process *proc, const source &src);
+
+    const ProcessSnapshot *snapshot;
+};
+
 struct gpu_device {
     std::string name = "";
     std::string vendor = "";
@@ -26,16 +49,21 @@ struct gpu_device {
 
 class GPU : public Tab {
 public:
-    GPU();
+    GPU(const ProcessSnapshot *snapshot, CmdlineCache *cmdlines);
     ~GPU() {};
 
+    void probe() override;
+    uint32_t get_metrics() const override;
+    void collect() override;
     void update() override;
     uint64_t get_pid_at_pos() override;
+    void write_batch(BatchWriter *out) override;
 private:
-    void update_gpu_process(struct gpu_process *proc);
     void find_gpu_processes();
 private:
-    std::vector<struct gpu_process> processes;
+    ProcessTable<struct gpu_process, struct gpu_sampler> processes;
+    TableSpec<struct gpu_process> columns;
+    std::vector<struct card_process> proc_vec;
     std::vector<struct gpu_device> devices;
 };
 
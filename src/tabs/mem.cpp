@@ -8,13 +8,6 @@
 #include <sstream> // stringstream
 #include <array>    // std::array
 
-#define COLUMN_1    0                   // pid
-#define COLUMN_2    COLUMN_1+8          // name
-#define COLUMN_3    COLUMN_2+30         // real/resident
-#define COLUMN_4    COLUMN_3+8          // virt
-#define COLUMN_5    COLUMN_4+8          // swap
-#define COLUMN_6    COLUMN_5+8          // uptime
-#define COLUMN_7    COLUMN_6+13         // cmd
 
 uint64_t MEM::get_pid_at_pos() {
     return processes.at(proc_table_pos).process.pid;
@@ -196,71 +189,46 @@ void MEM::dmi_decode_mem() {
     }
 }
 
-void MEM::update_mem_process(struct mem_process *proc) {
-    struct pid_stat stats;
-    read_pid_stat(proc->process.pid, &stats);
-    struct pid_statm statm = {};
-    read_pid_statm(proc->process.pid, &statm);
-    struct pid_status status = {};
-    read_pid_status(proc->process.pid, &status);
+void mem_sampler::sample(struct mem_process *proc, const source &src) {
+    const struct process_metrics &metrics = snapshot->get_process_metrics();
+    size_t i = snapshot->index_of(&src);
+    const struct pid_status &status = src.status;
 
-    get_pid_uptime(proc->process.pid, &proc->uptime);
+    proc->uptime = snapshot->get_pid_uptime(&src);
 
-    proc->virt = statm.size * page_size;
-    proc->real = statm.resident * page_size;
-    proc->swap = status.VmSwap.empty() ? 0 : std::stoul(status.VmSwap);
+    proc->virt = metrics.vsize[i];
+    proc->real = metrics.rss[i];
+    proc->swap = status.VmSwap;
 
 }
 
 void MEM::find_mem_processes() {
-	// Reset is_alive for all processes
-	for (struct mem_process &p : processes)
-			p.process.is_alive = false;
-
-    // Get currently active processes
-    std::vector<struct process> proc_vec;
-    find_processes(&proc_vec);
-
-    // Check if processes are new or already in vector
-    struct process proc;
-	for (struct mem_process &memproc : processes) {
-        for (int j = 0; j < (int)proc_vec.size(); j++) {
-            proc = proc_vec.at(j);
-            if (memproc.process.pid == proc.pid) {
-                // Found
-                memproc.process.is_alive = true;
-                std::vector<struct process>::iterator it = (proc_vec.begin() + j);
-                proc_vec.erase(it);
-                break;
-            }
-        }
-    }
-
-    // All processes that haven't been found and removed should be added to processes vector
-	for (struct process &p : proc_vec) {
-        struct mem_process cp = {0};
-        cp.process = p;
-        processes.push_back(cp);
-    }
-
-    // Clear dead processes
-    erase_from_vector<struct mem_process>(&processes, [](struct mem_process p) {
-			return (!p.process.is_alive);
-		});
+    processes.update(snapshot->get_processes());
+}
 
-    // Get rest of the fields for memproc
-	for (struct mem_process &memproc : processes)
-        MEM::update_mem_process(&memproc);
+MEM::MEM(const ProcessSnapshot *snapshot, CmdlineCache *cmdlines) : Tab(snapshot, cmdlines), processes(mem_sampler(snapshot)) {
+    columns = TableSpec<struct mem_process>({
+        pid_column<struct mem_process>(),
+        name_column<struct mem_process>(),
+        {"resident", {7, 7, 0}, ALIGN_RIGHT, [](const struct mem_process &p, char *buf, size_t size) {
+            return snprintf(buf, size, "%s", format_size(p.real).c_str());
+        }},
+        {"virtual", {7, 7, 2}, ALIGN_RIGHT, [](const struct mem_process &p, char *buf, size_t size) {
+            return snprintf(buf, size, "%s", format_size(p.virt).c_str());
+        }},
+        {"swap", {7, 7, 2}, ALIGN_RIGHT, [](const struct mem_process &p, char *buf, size_t size) {
+            return snprintf(buf, size, "%s", format_size(p.swap).c_str());
+        }},
+        uptime_column<struct mem_process>(),
+        command_column<struct mem_process>(),
+    });
+    set_table_spec(&columns);
 }
 
-MEM::MEM() {
+void MEM::probe() {
     dmi_decode_mem();
-    page_size = getpagesize();
 
     const int bank_offset = 2;
-
-    // Need to have some time between sampling, if it's too close samples are basically 0
-	wtimeout(tab_window, 1000);
     set_info_block_size(bank_offset+banks.size());
 
     if (!board_data.empty()) {
@@ -283,40 +251,34 @@ MEM::MEM() {
                 banks.at(i).Part_Number.c_str());
         else
             mvwprintw(tab_window, info_block_start+i+bank_offset, 0, "%s: Not installed", banks.at(i).Locator.c_str());
+}
 
-    update();
+uint32_t MEM::get_metrics() const {
+    // Sizes come from stat through the snapshot's metrics
+    return METRIC_STATUS;
 }
 
-void MEM::update() {
+void MEM::collect() {
+	STAT_TIMER(PHASE_READ);
     find_mem_processes();
+    processes.sort_top(sort_window(), [](const struct mem_process &p) {
+        return (double)p.real;
+    });
+    read_meminfo(&info);
+}
+
+void MEM::write_batch(BatchWriter *out) {
+    write_table(out, "mem", &processes, &columns);
+}
+
+void MEM::update() {
     process_vector_size = processes.size();
-    sort_vector<struct mem_process>(&processes,
-        [](const struct mem_process p1, const struct mem_process p2) {
-            return p1.real > p2.real;
-        });
 
-    read_meminfo(&info);
     mvwprintw(tab_window, info_block_start+1, 0, "Usage: %u/%u MB\tSwap: %u/%u MB",
         (info.MemTotal-info.MemAvailable) / 1000, info.MemTotal / 1000, (info.SwapTotal - info.SwapFree) / 1000, info.SwapTotal/1000);
 
     // Proc
-    uint32_t pos = proc_table_top;
-    struct mem_process *proc;
-    for (uint32_t i = 0; i <= proc_block_size; i++) {
-        proc = &processes.at(pos);
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_1, "%lu", proc->process.pid);
-        /* Clear extra characters if previous value was longer */
-		wclrtoeol(tab_window);
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_2, "%s", proc->process.name.c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_3, "%s", format_size(proc->real).c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_4, "%s", format_size(proc->virt).c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_5, "%s", format_size(proc->swap).c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_6, "%s", format_time(proc->uptime).c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_7, "%s", proc->process.cmd.c_str());
-        pos++;
-        if (pos >= processes.size())
-            break;
-    }
-    /* Invert the highlight of the currently selected process */
-    mvwchgat(tab_window, proc_block_start+proc_table_pos, 0, -1, A_REVERSE, 0, NULL);
+    // Scrolled past the rows ordered in collect()
+    processes.sort_more(sort_window());
+    draw_table(processes, &columns);
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include "tab.hpp"
 #include "../proc.hpp"
+#include "../process_table.hpp"
 
 struct mem_process {
 	struct process      process = {0};
@@ -44,23 +45,33 @@ struct dmi_mem_device {
 	std::string Configured_Voltage = "";
 };
 
+struct mem_sampler : public snapshot_sampler {
+    mem_sampler(const ProcessSnapshot *snapshot = nullptr) : snapshot_sampler(snapshot) {};
+
+    void sample(struct mem_process *proc, const source &src);
+};
+
 class MEM : public Tab {
 public:
-    MEM();
+    MEM(const ProcessSnapshot *snapshot, CmdlineCache *cmdlines);
     ~MEM() {};
 
+    void probe() override;
+    uint32_t get_metrics() const override;
+    void collect() override;
     void update() override;
     uint64_t get_pid_at_pos() override;
+    void write_batch(BatchWriter *out) override;
 private:
     void dmi_decode_mem();
-    void update_mem_process(struct mem_process *proc);
     void find_mem_processes();
 private:
-    std::vector<struct mem_process> processes;
+    ProcessTable<struct mem_process, struct mem_sampler> processes;
+    TableSpec<struct mem_process> columns;
     std::vector<struct dmi_mem_board_data> board_data;
     std::vector<struct dmi_mem_device> banks;
+    // As of the last collect()
     struct meminfo info;
-    uint32_t page_size;
 };
 
 #endif // MEM_HPP_
\ No newline at end of file
@@ -9,13 +9,6 @@
 #include <memory> // unique_ptr
 #include <array>    // std::array
 
-#define COLUMN_1    0                   // pid
-#define COLUMN_2    COLUMN_1+8          // name
-#define COLUMN_3    COLUMN_2+25         // user
-#define COLUMN_4    COLUMN_3+15         // type
-#define COLUMN_5    COLUMN_4+6          // node
-#define COLUMN_6    COLUMN_5+5          // connection
-#define COLUMN_7    COLUMN_6+13          // name
 
 uint64_t NET::get_pid_at_pos() {
     return processes.at(proc_table_pos).process.pid;
@@ -70,6 +63,8 @@ void NET::find_net_devices() {
     }
 
 	for (struct net_device &dev : devices) {
+        std::string old_v4 = dev.v4.address;
+        std::string old_v6 = dev.v6.address;
         for (struct ifaddrs *ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
             if (ifa->ifa_addr == NULL)
                 continue;
@@ -137,7 +132,12 @@ void NET::find_net_devices() {
                 dev.v6.network = std::string(network);
             }
         }
-        get_ssid(dev.id, &dev.ssid);
+        // iwgetid is a process per device, it's asked again only when the
+        // device joins another network, which changes its address
+        if (find_ssids && (dev.v4.address != old_v4 || dev.v6.address != old_v6)) {
+            dev.ssid.clear();
+            get_ssid(dev.id, &dev.ssid);
+        }
     }
 
     freeifaddrs(ifaddr);
@@ -146,11 +146,13 @@ void NET::find_net_devices() {
 void NET::find_net_interfaces() {
     std::vector<struct net_interface> net_vec;
     read_net_dev(&net_vec);
+    // /proc/net/dev is read here and not with the snapshot
+    uint64_t now_ns = monotonic_ns();
 
 	for (struct net_interface &pn : net_vec) {
         struct net_interface_ext pne = {};
         pne.net = pn;
-        get_uptime(&pne.last_checked);
+        pne.last_checked = now_ns;
         pne.download_per_s = 0;
         pne.upload_per_s = 0;
         interfaces.push_back(pne);
@@ -160,13 +162,14 @@ void NET::find_net_interfaces() {
 void NET::update_net_interfaces() {
     std::vector<struct net_interface> net_vec;
     read_net_dev(&net_vec);
+    uint64_t now_ns = monotonic_ns();
 
     std::vector<struct net_interface_ext> net_ifs = {};
     net_ifs.clear();
 	for (struct net_interface &pn : net_vec) {
         struct net_interface_ext pne = {};
         pne.net = pn;
-        get_uptime(&pne.last_checked);
+        pne.last_checked = now_ns;
         pne.download_per_s = 0;
         pne.upload_per_s = 0;
         net_ifs.push_back(pne);
@@ -174,7 +177,7 @@ void NET::update_net_interfaces() {
 
     uint64_t old_last_checked;
     uint64_t new_last_checked;
-    uint64_t time_delta;
+    double time_delta;
     double up = 0;
     double down = 0;
     for (uint32_t i = 0; i < interfaces.size(); i++) {
@@ -183,8 +186,8 @@ void NET::update_net_interfaces() {
 
         up = 0;
         down = 0;
-        time_delta = new_last_checked - old_last_checked;
-        if (time_delta) {
+        time_delta = (new_last_checked - old_last_checked) / 1000000000.0;
+        if (time_delta > 0) {
             up = (net_ifs.at(i).net.tx_bytes - interfaces.at(i).net.tx_bytes)*1.0 / time_delta;
             down = (net_ifs.at(i).net.rx_bytes - interfaces.at(i).net.rx_bytes)*1.0 / time_delta;
         } else {
@@ -198,7 +201,8 @@ void NET::update_net_interfaces() {
     }
 }
 
-void find_processes_with_connections(std::vector<struct net_process> *proc_vec) {
+void find_processes_with_connections(const ProcessSnapshot *snapshot, StringArena *strings,
+                                     std::vector<struct net_process> *proc_vec) {
     const char* cmd = "lsof -i";
     std::array<char, 256> buffer;
     std::string line;
@@ -233,8 +237,11 @@ void find_processes_with_connections(std::vector<struct net_process> *proc_vec)
         delim_pos = line.find_first_not_of(" ");
         line = line.substr(delim_pos);
         proc.process.pid = value.empty()? -1 : std::stoi(value);
-		get_process_name(proc.process.pid, &proc.process.name);
-		get_calling_command(proc.process.pid, &proc.process.cmd);
+        const struct process_sample *sample = snapshot->find(proc.process.pid);
+        if (sample) {
+            proc.process.starttime = sample->process.starttime;
+            memcpy(proc.process.name, sample->process.name, sizeof(proc.process.name));
+        }
 
         // USER
         delim_pos = line.find_first_of(" ");
@@ -242,7 +249,7 @@ void find_processes_with_connections(std::vector<struct net_process> *proc_vec)
         line = line.substr(delim_pos+1);
         delim_pos = line.find_first_not_of(" ");
         line = line.substr(delim_pos);
-        proc.user = value;
+        proc.user = strings->intern(value);
 
         // FD
         delim_pos = line.find_first_of(" ");
@@ -257,7 +264,7 @@ void find_processes_with_connections(std::vector<struct net_process> *proc_vec)
         line = line.substr(delim_pos+1);
         delim_pos = line.find_first_not_of(" ");
         line = line.substr(delim_pos);
-        proc.type = value;
+        proc.type = strings->intern(value);
 
         // DEVICE
         delim_pos = line.find_first_of(" ");
@@ -279,7 +286,7 @@ void find_processes_with_connections(std::vector<struct net_process> *proc_vec)
         line = line.substr(delim_pos+1);
         delim_pos = line.find_first_not_of(" ");
         line = line.substr(delim_pos);
-        proc.node = value;
+        proc.node = strings->intern(value);
 
         // NAME
         delim_pos = line.find_first_of(" ");
@@ -288,12 +295,12 @@ void find_processes_with_connections(std::vector<struct net_process> *proc_vec)
         delim_pos = line.find_first_not_of(" ");
         if (delim_pos != -1)
             line = line.substr(delim_pos);
-        proc.name = value;
+        proc.name = strings->intern(value);
 
         delim_pos = line.find_first_of("(");
         if (delim_pos != -1) {
-            proc.connection = line.substr(delim_pos+1);
-            proc.connection = proc.connection.substr(0, proc.connection.find_first_of(")"));
+            value = line.substr(delim_pos+1);
+            proc.connection = strings->intern(value.substr(0, value.find_first_of(")")));
         }
 
         proc_vec->push_back(proc);
@@ -301,80 +308,76 @@ void find_processes_with_connections(std::vector<struct net_process> *proc_vec)
 }
 
 void NET::find_net_processes() {
-	// Reset is_alive for all processes
-	for (struct net_process &p : processes)
-			p.process.is_alive = false;
-
-    // Get currently active processes
-    std::vector<struct net_process> proc_vec;
-    find_processes_with_connections(&proc_vec);
-
-    // Check if processes are new or already in vector
-	for (struct net_process &netproc : processes) {
-        for (int j = 0; j < (int)proc_vec.size(); j++) {
-            if (netproc.process.pid == proc_vec.at(j).process.pid) {
-                // Found
-                netproc.process.is_alive = true;
-                proc_vec.erase(proc_vec.begin() + j);
-                break;
-            }
-        }
-    }
+    // Get currently active processes, a pid shows up once per connection
+    proc_vec.clear();
+    find_processes_with_connections(snapshot, &strings, &proc_vec);
 
-    // All processes that haven't been found and removed should be added to processes vector
-	for (struct net_process &p : proc_vec)
-        processes.push_back(p);
-
-    // Clear dead processes
-    erase_from_vector<struct net_process>(&processes, [](struct net_process p) {
-			return (!p.process.is_alive);
-		});
+    processes.update(proc_vec);
+    // Rows that are gone took the last references to their strings
+    strings.sweep();
 }
 
-NET::NET() {
+NET::NET(const ProcessSnapshot *snapshot, CmdlineCache *cmdlines) : Tab(snapshot, cmdlines) {
+    columns = TableSpec<struct net_process>({
+        pid_column<struct net_process>(),
+        {"name", {15, 24, 0}, ALIGN_LEFT, [](const struct net_process &p, char *buf, size_t size) {
+            return snprintf(buf, size, "%s", p.process.name);
+        }},
+        {"user", {8, 14, 2}, ALIGN_LEFT, [this](const struct net_process &p, char *buf, size_t size) {
+            return snprintf(buf, size, "%s", strings.c_str(p.user));
+        }},
+        {"type", {4, 5, 3}, ALIGN_LEFT, [this](const struct net_process &p, char *buf, size_t size) {
+            return snprintf(buf, size, "%s", strings.c_str(p.type));
+        }},
+        {"protocol", {4, 4, 3}, ALIGN_LEFT, [this](const struct net_process &p, char *buf, size_t size) {
+            return snprintf(buf, size, "%s", strings.c_str(p.node));
+        }},
+        {"state", {11, 12, 1}, ALIGN_LEFT, [this](const struct net_process &p, char *buf, size_t size) {
+            return snprintf(buf, size, "%s", strings.c_str(p.connection));
+        }},
+        {"address", {20, 0, 0}, ALIGN_LEFT, [this](const struct net_process &p, char *buf, size_t size) {
+            return snprintf(buf, size, "%s", strings.c_str(p.name));
+        }},
+    });
+    set_table_spec(&columns);
     find_net_interfaces();
+};
 
-    // Need to have some time between sampling, if it's too close samples are basically 0
-	wtimeout(tab_window, 1000);
+void NET::probe() {
+    find_ssids = true;
+}
 
-    update();
-};
+uint32_t NET::get_metrics() const {
+    return METRIC_STAT | METRIC_SOCKETS;
+}
 
-void NET::update() {
-    // Info
-    find_net_devices();
+void NET::collect() {
+	STAT_TIMER(PHASE_READ);
 	update_net_interfaces();
+    find_net_devices();
 
     uint32_t old_size = processes.size();
     find_net_processes();
     if (old_size != processes.size())
-        sort_vector<struct net_process>(&processes,
-            [](const struct net_process p1, const struct net_process p2) {
-                int val1 = 0;
-                if (p1.connection == "ESTABLISHED")
-                    val1 = 2;
-                else if (p1.connection == "LISTEN")
-                    val1 = 1;
-
-                int val2 = 0;
-                if (p2.connection == "ESTABLISHED")
-                    val2 = 2;
-                else if (p2.connection == "LISTEN")
-                    val2 = 1;
-
-                return val1 > val2;
-            });
-
-    // If a network device was removed extend proc block up
-    uint32_t previous_size = process_vector_size;
+        // Not re-sorted every tick, so all of it is put in order
+        processes.sort_top(processes.size(), [this](const struct net_process &p) {
+            std::string_view connection = strings.view(p.connection);
+            if (connection == "ESTABLISHED")
+                return 2.0;
+            else if (connection == "LISTEN")
+                return 1.0;
+            return 0.0;
+        });
+}
+
+void NET::write_batch(BatchWriter *out) {
+    write_table(out, "net", &processes, &columns);
+}
+
+void NET::update() {
+    // Info
+    // If a network device was removed the table clears the rows it moves up to
     process_vector_size = processes.size();
-    if (process_vector_size != previous_size)
-        for (uint32_t i = 0; i < process_vector_size; i++) {
-            // Move cursor to beginning of row
-            mvcur(getcurx(tab_window), getcury(tab_window), info_block_start+i, 0);
-            // Erase row
-		    wclrtoeol(tab_window);
-        }
 
     int info_offset = 0;
     for (int i = 0; i < (int)devices.size(); i++) {
@@ -418,23 +421,5 @@ void NET::update() {
     set_info_block_size(info_offset);
 
     // Proc
-    uint32_t pos = proc_table_top;
-    struct net_process *proc;
-    for (uint32_t i = 0; i <= proc_block_size; i++) {
-        proc = &processes.at(pos);
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_1, "%lu", proc->process.pid);
-        /* Clear extra characters if previous value was longer */
-		wclrtoeol(tab_window);
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_2, "%s", proc->process.name.c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_3, "%s", proc->user.c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_4, "%s", proc->type.c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_5, "%s", proc->node.c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_6, "%s", proc->connection.c_str());
-        mvwprintw(tab_window, proc_block_start+i, COLUMN_7, "%s", proc->name.c_str());
-        pos++;
-        if (pos >= processes.size())
-            break;
-    }
-    /* Invert the highlight of the currently selected process */
-    mvwchgat(tab_window, proc_block_start+proc_table_pos, 0, -1, A_REVERSE, 0, NULL);
+    draw_table(processes, &columns);
 }
@@ -3,42 +3,71 @@
 
 #include "tab.hpp"
 #include "../proc.hpp"
+#include "../process_table.hpp"
 #include "../sys.hpp"
+#include "../string_arena.hpp"
 
 #include <map>
 
 struct net_interface_ext {
         struct net_interface net = {};
-        uint64_t last_checked = 0; // in seconds
+        uint64_t last_checked = 0; // CLOCK_MONOTONIC in ns
         double upload_per_s = 0; // B/s
         double download_per_s = 0; // B/s
 };
 
 struct net_process {
 	struct process process = {0};
-    std::string user = "";
-    std::string type = "";
-    std::string node = "";
-    std::string name = "";
-    std::string connection = "";
+    // Handles into the tab's StringArena, lsof repeats these a lot
+    uint32_t user = StringArena::EMPTY;
+    uint32_t type = StringArena::EMPTY;
+    uint32_t node = StringArena::EMPTY;
+    uint32_t name = StringArena::EMPTY;
+    uint32_t connection = StringArena::EMPTY;
+};
+
+// lsof rows are complete on their own, the latest one replaces the row
+// so it only holds handles of the current tick
+struct net_sampler {
+    typedef struct net_process source;
+
+    struct pid_key key(const source &src) const {
+        return {src.process.pid, src.process.starttime};
+    }
+    void init(struct net_process *proc, const source &src) {
+        *proc = src;
+    }
+    void sample(struct net_process *proc, const source &src) {
+        *proc = src;
+    }
 };
 
 class NET : public Tab {
 public:
-    NET();
+    NET(const ProcessSnapshot *snapshot, CmdlineCache *cmdlines);
     ~NET() {};
 
+    void probe() override;
+    uint32_t get_metrics() const override;
+    void collect() override;
     void update() override;
     uint64_t get_pid_at_pos() override;
+    void write_batch(BatchWriter *out) override;
 private:
     void find_net_devices();
     void find_net_processes();
     void find_net_interfaces();
     void update_net_interfaces();
 private:
-    std::vector<struct net_process> processes;
+    ProcessTable<struct net_process, struct net_sampler> processes;
+    TableSpec<struct net_process> columns;
+    std::vector<struct net_process> proc_vec;
+    // Strings of the lsof rows, swept once per tick
+    StringArena strings;
     std::vector<struct net_device> devices;
     std::vector<struct net_interface_ext> interfaces;
+    // The ssid shells out, it's only looked up for the screen
+    bool find_ssids = false;
 };
 
 #endif // NET_HPP_
\ No newline at end of file
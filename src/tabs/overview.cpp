@@ -20,6 +20,14 @@ uint64_t Overview::get_pid_at_pos() {
     return 0;
 }
 
+uint32_t Overview::get_metrics() const {
+    return METRIC_STAT;
+}
+
+void Overview::collect() {
+    // Nothing kept between ticks, everything is read when drawing
+}
+
 struct monitor {
 	std::string manufacturer = "";
 	std::string model = "";
@@ -223,10 +231,11 @@ void get_active_users(std::vector<struct active_user> *users) {
 
 }
 
-Overview::Overview() {
-	find_processes(&processes);
-	process_vector_size = processes.size();
+Overview::Overview(const ProcessSnapshot *snapshot, CmdlineCache *cmdlines) : Tab(snapshot, cmdlines) {
+	process_vector_size = snapshot->get_processes().size();
+}
 
+void Overview::probe() {
 	mvwprintw(tab_window, info_block_start, 0, "Loading");
 	wrefresh(tab_window);
 
@@ -251,7 +260,6 @@ Overview::Overview() {
 			monitors[i].built_in ? "built-in" : "");
 
 	set_info_block_size(row);
-	update();
 }
 
 void Overview::update() {
@@ -259,8 +267,7 @@ void Overview::update() {
 
 	mvwprintw(tab_window, proc_block_start + row++, 0, "Current server time is: %s",
 		get_current_time_str().c_str());
-    uint64_t system_uptime;
-    get_uptime(&system_uptime);
+    uint64_t system_uptime = snapshot->get_uptime();
     mvwprintw(tab_window, proc_block_start + row++, 0, "Uptime: %s\n", format_time(system_uptime).c_str());
 
 	row++;
@@ -271,9 +278,9 @@ void Overview::update() {
 		mvwprintw(tab_window, proc_block_start + row, COLUMN_2, "%s", users[i].tty.c_str());
 		mvwprintw(tab_window, proc_block_start + row, COLUMN_3, "%s", users[i].last_active.c_str());
 		mvwprintw(tab_window, proc_block_start + row, COLUMN_4, "%s", users[i].connection.c_str());
-		std::string command = "";
-		get_process_name(users[i].active_connection_pid, &command);
-		mvwprintw(tab_window, proc_block_start + row, COLUMN_5, "%s", command.c_str());
+		const struct process_sample *sample = snapshot->find(users[i].active_connection_pid);
+		mvwprintw(tab_window, proc_block_start + row, COLUMN_5, "%s",
+			sample ? sample->process.name : "");
 		row++;
 	}
 	for (int i = row; i < (int)proc_block_size; i++) {
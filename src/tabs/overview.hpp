@@ -7,13 +7,15 @@
 
 class Overview : public Tab {
 public:
-    Overview();
+    Overview(const ProcessSnapshot *snapshot, CmdlineCache *cmdlines);
     ~Overview() {};
 
+    void probe() override;
+    uint32_t get_metrics() const override;
+    void collect() override;
     void update() override;
     uint64_t get_pid_at_pos() override;
 private:
-    std::vector<struct process> processes;
     struct utsname osInfo;
 };
 
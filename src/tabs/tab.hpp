@@ -1,6 +1,16 @@
 #ifndef TAB_HPP_
 #define TAB_HPP_
 
+#include "../proc.hpp"
+#include "../cmdline_cache.hpp"
+#include "../process_table.hpp"
+#include "../table_spec.hpp"
+#include "../batch.hpp"
+#include "../util.hpp" // format_time
+
+#include <cstdio> // snprintf
+#include <algorithm> // std::min, std::max
+
 extern "C" {
 	#include <ncurses.h> //GUI
     #include <panel.h>
@@ -8,7 +18,7 @@ extern "C" {
 
 class Tab {
 public:
-    Tab() {
+    Tab(const ProcessSnapshot *snapshot, CmdlineCache *cmdlines) : snapshot(snapshot), cmdlines(cmdlines) {
         int terminal_height;
         int terminal_width;
         getmaxyx(stdscr, terminal_height, terminal_width);
@@ -16,16 +26,32 @@ public:
         tab_window = newwin(terminal_height-navbar_offset, terminal_width, navbar_offset, 0);
         tab_panel = new_panel(tab_window);
 
-        wtimeout(tab_window,(50));
+        // Keys are read from the tab's window once poll() says there are some
+        nodelay(tab_window, TRUE);
+        keypad(tab_window, TRUE);
     };
     ~Tab() {
         del_panel(tab_panel);
         delwin(tab_window);
     };
 
+    // Look up the hardware the info block describes and draw what doesn't
+    // change. Some of it shells out, so it's only done for the screen and
+    // never in batch mode.
+    virtual void probe() {};
+    // Metric groups collect() needs in the snapshot
+    virtual uint32_t get_metrics() const = 0;
+    // Take in a new snapshot. Runs on every tick while the tab is visible and
+    // on full ticks while it's hidden, so rates are current when it's shown.
+    virtual void collect() = 0;
+    // Draw the collected data, also on keypresses in between snapshots
     virtual void update() = 0;
 
     virtual uint64_t get_pid_at_pos() = 0;
+    // Write every row of the process table, tabs without one write nothing
+    virtual void write_batch(BatchWriter *out) {
+        (void)out;
+    };
 
     void proc_up() {
         // If position is already on top, just scroll
@@ -55,6 +81,13 @@ public:
             proc_table_pos++;
     }
 
+    // Fit the window to a resized terminal, the table is laid out and drawn from scratch
+    void resize(int terminal_height, int terminal_width) {
+        wresize(tab_window, terminal_height-navbar_offset, terminal_width);
+        set_info_block_size(info_block_size);
+        layout_table();
+    }
+
     WINDOW * get_window() {
         return tab_window;
     }
@@ -62,18 +95,105 @@ public:
         return tab_panel;
     }
 protected:
-    void set_info_block_size(uint8_t new_size) {
+    // Columns most process tables share, Row needs process and uptime members
+    template<typename Row>
+    static struct table_column<Row> pid_column() {
+        return {"pid", {7, 7, 0}, ALIGN_LEFT, [](const Row &row, char *buf, size_t size) {
+            return snprintf(buf, size, "%lu", row.process.pid);
+        }};
+    }
+    template<typename Row>
+    static struct table_column<Row> name_column() {
+        return {"name", {15, 29, 0}, ALIGN_LEFT, [](const Row &row, char *buf, size_t size) {
+            return snprintf(buf, size, "%s", row.process.name);
+        }};
+    }
+    template<typename Row>
+    static struct table_column<Row> uptime_column() {
+        return {"uptime", {8, 12, 3}, ALIGN_LEFT, [](const Row &row, char *buf, size_t size) {
+            return snprintf(buf, size, "%s", format_time(row.uptime).c_str());
+        }};
+    }
+    template<typename Row>
+    struct table_column<Row> command_column() {
+        return {"command", {10, 0, 1}, ALIGN_LEFT, [this](const Row &row, char *buf, size_t size) {
+            return snprintf(buf, size, "%s", cmdlines->get(row.process));
+        }};
+    }
+
+    // Rows of the process table that have to be in order, the visible ones
+    // and a page ahead so scrolling doesn't need a full sort
+    uint32_t sort_window() const {
+        return proc_table_top + 2 * (proc_block_size + 1);
+    }
+    void set_info_block_size(uint32_t new_size) {
         info_block_size = new_size;
 
-        proc_block_start = info_block_size;
-        proc_block_size = getmaxy(tab_window) - proc_block_start;
+        // An info block taller than the window leaves the table a row,
+        // the rest of the block is cut off
+        uint32_t height = std::max(getmaxy(tab_window), 1);
+        proc_block_start = std::min(info_block_size, height - 1);
+        proc_block_size = height - proc_block_start;
 
         if (proc_table_pos > proc_block_size)
             proc_table_pos = proc_block_size;
+        table.resize(proc_block_start, proc_block_size + 1);
+    }
+    // Columns of the process table, laid out again on every resize
+    void set_table_spec(TableLayout *spec) {
+        table_spec = spec;
+        layout_table();
+    }
+    void layout_table() {
+        if (!table_spec)
+            return;
+        table_spec->layout(getmaxx(tab_window));
+        table.set_layout(tab_window, table_spec->get_offsets(), table_spec->get_widths());
+        table.resize(proc_block_start, proc_block_size + 1);
+    }
+    // Draw the rows of processes that are on screen, only those get formatted
+    template<typename Row, typename Sampler>
+    void draw_table(const ProcessTable<Row, Sampler> &processes, TableSpec<Row> *spec) {
+        for (uint32_t i = 0; i <= proc_block_size; i++) {
+            uint32_t pos = proc_table_top + i;
+            if (pos < processes.size())
+                spec->draw_row(&table, i, processes.at(pos));
+            else
+                table.clear_row(i);
+        }
+        /* Invert the highlight of the currently selected process */
+        table.select(proc_table_pos);
+    }
+    // Write all of processes in display order, every column of spec
+    template<typename Row, typename Sampler>
+    void write_table(BatchWriter *out, std::string_view table,
+                     ProcessTable<Row, Sampler> *processes, TableSpec<Row> *spec) {
+        // Only the rows on screen are kept in order otherwise
+        processes->sort_more(processes->size());
+        const std::vector<struct table_column<Row>> &columns = spec->get_columns();
+        std::vector<std::string_view> ids;
+        for (const struct table_column<Row> &column : columns)
+            ids.push_back(column.id);
+        out->begin_table(table, ids);
+        for (uint32_t pos = 0; pos < processes->size(); pos++) {
+            out->begin_row();
+            for (uint32_t c = 0; c < columns.size(); c++)
+                out->field(spec->format(processes->at(pos), c));
+            out->end_row();
+        }
     }
 protected:
+    // Shared per-tick process data, owned by main
+    const ProcessSnapshot *snapshot;
+    // Command lines of displayed rows, owned by main
+    CmdlineCache *cmdlines;
+
     WINDOW * tab_window;
     PANEL * tab_panel;
+    // Draws the process block, only the cells that changed
+    TableRenderer table;
+    // Owned by the derived tab
+    TableLayout *table_spec = nullptr;
 
 	// Offset by 1 for navbar
 	uint8_t navbar_offset = 1;
@@ -88,8 +208,8 @@ protected:
     uint8_t info_block_start = 0;
     // Row on screen at which the process block starts
     uint32_t proc_block_start = 1;
-    // From 0 to size (including size)
-    uint8_t info_block_size = 1;
+    // Rows the tab asked for, the table may start before that in a short window
+    uint32_t info_block_size = 1;
     // From 0 to size (including size)
     uint32_t proc_block_size = 1;
 };
@@ -8,26 +8,44 @@
 extern "C" {
 	#include <unistd.h> // getuid()
 	#include <getopt.h> // longopts, shortopts
+	#include <sys/signalfd.h>
 }
 
 bool quit = false;
 bool lock = false;
-
-void sig_handler(int signo) {
-	std::cout << "Signal " << signo << " detected. Quitting" << std::endl;
-	quit = true;
+unsigned jobs = 0;
+bool proc_events = false;
+bool use_taskstats = false;
+size_t cmdline_max = 4096;
+bool count_frame_bytes = false;
+bool show_costs = false;
+bool batch = false;
+uint32_t batch_count = 0;
+enum batch_format batch_format = FORMAT_CSV;
+uint32_t update_interval_ms = UPDATE_INTERVAL_MS;
+
+int setup_signal_fd() {
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGTERM);
+	sigaddset(&mask, SIGWINCH);
+	// Blocked before any thread starts, so they all inherit the mask and
+	// the signals only ever show up on the fd
+	pthread_sigmask(SIG_BLOCK, &mask, NULL);
+	int fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (fd == -1) {
+		std::cout << "signalfd() failed" << std::endl;
+		exit(1);
+	}
+	return fd;
 }
 
-void setup_signal_handler() {
-	struct sigaction act;
-	act.sa_handler = sig_handler;
-	act.sa_flags = SA_NODEFER | SA_SIGINFO;
-	/* Signals blocked during the execution of the handler. */
-	sigemptyset(&act.sa_mask);
-	sigaddset(&act.sa_mask, SIGINT);
-	sigaddset(&act.sa_mask, SIGTERM);
-	sigaction(SIGINT, &act, NULL);
-	sigaction(SIGTERM, &act, NULL);
+int read_signal(const int fd) {
+	struct signalfd_siginfo info;
+	if (read(fd, &info, sizeof(info)) != sizeof(info))
+		return 0;
+	return info.ssi_signo;
 }
 
 void check_root() {
@@ -41,13 +59,32 @@ void help(const std::string prog) {
 	std::cout << "glimpse [" << prog << "] version: " << VERSION << std::endl;
 	std::cout << "[-h\t--help]\t\tPrint this message" << std::endl;
 	std::cout << "[-v\t--version]\tPrint version" << std::endl;
+	std::cout << "[-j\t--jobs N]\tThreads reading /proc, defaults to one per core" << std::endl;
+	std::cout << "[-e\t--events]\tTrack processes through proc connector events" << std::endl;
+	std::cout << "[-t\t--taskstats]\tRead process accounting through taskstats" << std::endl;
+	std::cout << "[-c\t--cmdline-max N]\tCut command lines off after N bytes, 4096 by default" << std::endl;
+	std::cout << "[-b\t--frame-bytes]\tPrint the bytes written to the terminal per frame on exit" << std::endl;
+	std::cout << "[-d\t--interval MS]\tSample every MS milliseconds, 1000 by default" << std::endl;
+	std::cout << "[-B\t--batch]\tWrite the process tables to stdout every sample, without a terminal" << std::endl;
+	std::cout << "[-n\t--count N]\tStop batch mode after N samples, no limit by default" << std::endl;
+	std::cout << "[-f\t--format F]\tBatch output as csv or jsonl, csv by default" << std::endl;
 }
 
 void read_args(int argc, char *argv[]) {
-	static const char *shortopts = "hv";
+	static const char *shortopts = "hvj:etc:bd:Bn:f:";
 	static const struct option longopts[] = {
 		{"help", no_argument, NULL, 'h'},
-		{"version", no_argument, NULL, 'v'}
+		{"version", no_argument, NULL, 'v'},
+		{"jobs", required_argument, NULL, 'j'},
+		{"events", no_argument, NULL, 'e'},
+		{"taskstats", no_argument, NULL, 't'},
+		{"cmdline-max", required_argument, NULL, 'c'},
+		{"frame-bytes", no_argument, NULL, 'b'},
+		{"interval", required_argument, NULL, 'd'},
+		{"batch", no_argument, NULL, 'B'},
+		{"count", required_argument, NULL, 'n'},
+		{"format", required_argument, NULL, 'f'},
+		{NULL, 0, NULL, 0}
 	};
 	std::string prog = "Unknown prog name";
 	if (argc >= 1) {
@@ -64,6 +101,70 @@ void read_args(int argc, char *argv[]) {
 		case 'v':
 			std::cout << prog << " version: " << VERSION << std::endl;
 			exit(0);
+		case 'j': {
+			char *end;
+			long value = strtol(optarg, &end, 10);
+			if (*end != '\0' || value < 0) {
+				std::cout << "Invalid job count: " << optarg << std::endl;
+				exit(1);
+			}
+			jobs = value;
+			break;
+		}
+		case 'e':
+			proc_events = true;
+			break;
+		case 't':
+			use_taskstats = true;
+			break;
+		case 'c': {
+			char *end;
+			long value = strtol(optarg, &end, 10);
+			if (*end != '\0' || value <= 0) {
+				std::cout << "Invalid command line length: " << optarg << std::endl;
+				exit(1);
+			}
+			cmdline_max = value;
+			break;
+		}
+		case 'b':
+			count_frame_bytes = true;
+			break;
+		case 'd': {
+			char *end;
+			long value = strtol(optarg, &end, 10);
+			if (*end != '\0' || value <= 0) {
+				std::cout << "Invalid interval: " << optarg << std::endl;
+				exit(1);
+			}
+			update_interval_ms = value;
+			break;
+		}
+		case 'B':
+			batch = true;
+			break;
+		case 'n': {
+			char *end;
+			long value = strtol(optarg, &end, 10);
+			if (*end != '\0' || value < 0) {
+				std::cout << "Invalid count: " << optarg << std::endl;
+				exit(1);
+			}
+			batch_count = value;
+			break;
+		}
+		case 'f': {
+			std::string format(optarg);
+			if (format == "csv") {
+				batch_format = FORMAT_CSV;
+			} else if (format == "jsonl") {
+				batch_format = FORMAT_JSONL;
+			} else {
+				std::cout << "Invalid format: " << optarg << std::endl;
+				exit(1);
+			}
+			break;
+		}
 		default:
 			return;
 		}
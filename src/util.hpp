@@ -3,14 +3,43 @@
 
 #include <string>
 #include <vector>
-#include <algorithm> // std::sort
+#include <algorithm> // std::remove_if
 #include <cstdint>
 
 #define VERSION			"0.1beta"
+// Default sampling interval, 1s
+#define UPDATE_INTERVAL_MS	(1000)
+
+enum batch_format {
+	FORMAT_CSV,
+	FORMAT_JSONL,
+};
 
 extern bool lock;
+// Threads reading /proc, 0 for one per core
+extern unsigned jobs;
+// Track processes through proc connector events
+extern bool proc_events;
+// Read per-process accounting through taskstats
+extern bool use_taskstats;
+// Longest command line shown, in bytes
+extern size_t cmdline_max;
+// Count the bytes every frame writes to the terminal
+extern bool count_frame_bytes;
+// Show what the last tick cost next to the tab names, toggled with o
+extern bool show_costs;
+// Time between two samples
+extern uint32_t update_interval_ms;
+// Write the process tables to stdout instead of drawing them
+extern bool batch;
+// Snapshots written in batch mode, 0 for no limit
+extern uint32_t batch_count;
+extern enum batch_format batch_format;
 
-void setup_signal_handler();
+// Block SIGINT, SIGTERM and SIGWINCH and return a signalfd receiving them
+int setup_signal_fd();
+// Next signal waiting on fd, 0 if there's none
+int read_signal(const int fd);
 void check_root();
 void help(const std::string prog);
 void read_args(int argc, char *argv[]);
@@ -19,13 +48,6 @@ std::string format_size(uint64_t size);
 std::string center_string(const std::string str, const uint32_t width);
 std::string get_current_time_str();
 
-template<typename T>
-void sort_vector(std::vector<T> *vec, bool (*sort_criteria)(T a, T b)) {
-	if (lock)
-		return;
-    std::sort(vec->begin(), vec->end(), sort_criteria);
-}
-
 template<typename T>
 void erase_from_vector(std::vector<T> *vec, bool (*erase_criteria)(T a)) {
 	vec->erase(std::remove_if(vec->begin(), vec->end(),
@@ -0,0 +1,85 @@
+#include "worker_pool.hpp"
+
+#include <algorithm> // std::min, std::max
+
+WorkerPool::WorkerPool(unsigned thread_count) {
+	if (thread_count == 0)
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+	ranges.reset(new struct range[thread_count]);
+	for (unsigned i = 1; i < thread_count; i++)
+		threads.emplace_back(&WorkerPool::worker_loop, this, i);
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		stopping = true;
+	}
+	start.notify_all();
+	for (std::thread &t : threads)
+		t.join();
+}
+
+void WorkerPool::run(const size_t count, void (*fn)(void *, size_t), void *ctx) {
+	// Not worth waking anyone up for a single chunk
+	if (threads.empty() || count <= CHUNK) {
+		for (size_t i = 0; i < count; i++)
+			fn(ctx, i);
+		return;
+	}
+
+	const unsigned thread_count = size();
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		size_t per_thread = (count + thread_count - 1) / thread_count;
+		for (unsigned i = 0; i < thread_count; i++) {
+			size_t begin = std::min(count, i * per_thread);
+			ranges[i].next.store(begin, std::memory_order_relaxed);
+			ranges[i].end = std::min(count, begin + per_thread);
+		}
+		job = fn;
+		job_ctx = ctx;
+		running = threads.size();
+		generation++;
+	}
+	start.notify_all();
+
+	work(0);
+
+	std::unique_lock<std::mutex> guard(mutex);
+	done.wait(guard, [this] { return running == 0; });
+}
+
+void WorkerPool::work(const unsigned id) {
+	const unsigned thread_count = size();
+	for (unsigned n = 0; n < thread_count; n++) {
+		// Own range first, then the others in order
+		struct range &r = ranges[(id + n) % thread_count];
+		size_t begin;
+		while ((begin = r.next.fetch_add(CHUNK, std::memory_order_relaxed)) < r.end) {
+			size_t end = std::min(r.end, begin + CHUNK);
+			for (size_t i = begin; i < end; i++)
+				job(job_ctx, i);
+		}
+	}
+}
+
+void WorkerPool::worker_loop(const unsigned id) {
+	uint64_t seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> guard(mutex);
+			start.wait(guard, [&] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+			seen = generation;
+		}
+
+		work(id);
+
+		std::lock_guard<std::mutex> guard(mutex);
+		if (--running == 0)
+			done.notify_one();
+	}
+}
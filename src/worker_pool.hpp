@@ -0,0 +1,67 @@
+#ifndef WORKER_POOL_HPP_
+#define WORKER_POOL_HPP_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory> // unique_ptr
+#include <cstdint>
+#include <cstddef>
+
+/* Fixed set of threads that run a loop body over an index range.
+ * The range is split evenly between the threads up front. Each one takes
+ * chunks off its own part with an atomic fetch_add, and when it runs out
+ * it steals chunks from the others the same way. Only starting and
+ * finishing a loop takes the mutex.
+ */
+class WorkerPool {
+public:
+	// threads counts the calling thread too, 1 runs everything inline
+	// and 0 uses one per core
+	WorkerPool(unsigned threads);
+	~WorkerPool();
+
+	// Call fn(i) for every i in [0, count) and return once all calls are done.
+	// Calls run concurrently, fn must only write state owned by index i.
+	template<typename Fn>
+	void for_each(const size_t count, Fn fn) {
+		run(count, [](void *ctx, size_t i) {
+			(*static_cast<Fn *>(ctx))(i);
+		}, &fn);
+	}
+
+	unsigned size() const {
+		return threads.size() + 1;
+	}
+private:
+	// Indices handed out per fetch_add
+	static constexpr size_t CHUNK = 16;
+
+	struct alignas(64) range {
+		std::atomic<size_t> next{0};
+		size_t end = 0;
+	};
+
+	void run(const size_t count, void (*fn)(void *, size_t), void *ctx);
+	void worker_loop(const unsigned id);
+	// Drain range id, then steal from the other ranges
+	void work(const unsigned id);
+
+	std::vector<std::thread> threads;
+	// One per thread, the caller uses 0
+	std::unique_ptr<struct range[]> ranges;
+
+	std::mutex mutex;
+	std::condition_variable start;
+	std::condition_variable done;
+	uint64_t generation = 0;
+	unsigned running = 0;
+	bool stopping = false;
+
+	void (*job)(void *, size_t) = nullptr;
+	void *job_ctx = nullptr;
+};
+
+#endif // WORKER_POOL_HPP_